@@ -0,0 +1,135 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Event benchmarks: triggering an event with a number of tasks waiting on it, and setting a bit in an event
+ * group that only one of the waiting tasks is waiting for. notify_task wakes a single waiting task through
+ * its notification word, to compare with trigger_event at 1 waiter.
+ */
+
+#include "bench.h"
+#include "event.h"
+#include "notify.h"
+#include "rtos.h"
+
+#define MAX_WAITERS     100
+#define ITERATIONS      10000
+
+static Task_t tasks[MAX_WAITERS];
+
+static const uint32_t waiterCounts[] = { 1, 10, 100 };
+
+#define NUM_COUNTS (sizeof(waiterCounts) / sizeof(waiterCounts[0]))
+
+static void BenchTriggerEvent()
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t k;
+    Event_t  event;
+
+    for(i = 0; i < NUM_COUNTS; i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        RTOS_Initialize();
+        InitEvent(&event);
+
+        for(j = 0; j < waiterCounts[i]; j++)
+        {
+            BenchInitTask(&tasks[j], PRIORITY_1);
+            StartTask(&tasks[j]);
+        }
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            // Switch to the waiting tasks and block each one in turn, which leaves the idle task running
+            Tick();
+
+            for(k = 0; k < waiterCounts[i]; k++)
+            {
+                WaitForEvent(&event);
+            }
+
+            BenchStart(&start);
+            TriggerEvent(&event);
+            BenchStop(&start, &total);
+        }
+
+        BenchReport("trigger_event", "waiters", waiterCounts[i], ITERATIONS, &total);
+    }
+}
+
+static void BenchSetBits()
+{
+    uint32_t     i;
+    uint32_t     j;
+    uint32_t     k;
+    EventGroup_t group;
+
+    for(i = 0; i < NUM_COUNTS; i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        RTOS_Initialize();
+        InitEventGroup(&group);
+
+        for(j = 0; j < waiterCounts[i]; j++)
+        {
+            BenchInitTask(&tasks[j], PRIORITY_1);
+            StartTask(&tasks[j]);
+        }
+
+        Tick();
+
+        for(k = 0; k < waiterCounts[i]; k++)
+        {
+            // The others share bits 1 to 31, so bit 0 is only ever the first waiter's
+            WaitBits(&group, (k == 0) ? 0x1 : ((uintd_t)1 << (1 + k % 31)), false, true);
+        }
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            // Only the first waiter is readied, then it waits again
+            BenchStart(&start);
+            SetBits(&group, 0x1);
+            BenchStop(&start, &total);
+
+            Tick();
+            WaitBits(&group, 0x1, false, true);
+        }
+
+        BenchReport("set_bits", "waiters", waiterCounts[i], ITERATIONS, &total);
+    }
+}
+
+static void BenchNotifyTask()
+{
+    uint32_t    j;
+    BenchTime_t start;
+    BenchTime_t total = { 0, 0 };
+
+    RTOS_Initialize();
+    BenchInitTask(&tasks[0], PRIORITY_1);
+    StartTask(&tasks[0]);
+
+    for(j = 0; j < ITERATIONS; j++)
+    {
+        Tick();
+        WaitNotify(~0U);
+
+        BenchStart(&start);
+        NotifyTask(&tasks[0], 1, NOTIFY_SET_BITS);
+        BenchStop(&start, &total);
+    }
+
+    BenchReport("notify_task", "waiters", 1, ITERATIONS, &total);
+}
+
+void BenchEvent()
+{
+    BenchTriggerEvent();
+    BenchSetBits();
+    BenchNotifyTask();
+}
@@ -0,0 +1,193 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Queue benchmarks: a non-blocking Enqueue followed by a Dequeue, for a range of element sizes.
+ *
+ * Each size is run twice, once with the copy InitQueue picks and once with a byte at a time loop
+ * (how elements used to be copied) so the two can be compared. Throughput counts the bytes of
+ * one element going in and out.
+ *
+ * The queue has a power of two length, so indexing uses a mask. enqueue_dequeue_non_pow2 is the same
+ * run on a queue one element shorter, which has to divide instead.
+ *
+ * enqueue_dequeue_many moves a batch of 4 byte elements with EnqueueMany and DequeueMany, timed per element
+ * so it can be compared with enqueue_dequeue at 4 bytes.
+ *
+ * ring_put_get does the same as enqueue_dequeue through a Ring_t, which doesn't take a critical section.
+ *
+ * semaphore_give_take gives then takes a Semaphore_t that never has to block, and queue_give_take does the same
+ * with a queue of dummy bytes used as a semaphore. Critical sections are free on the host port, so here the queue
+ * only pays for its copies while the semaphore pays for its atomic instructions, the opposite of most targets.
+ */
+
+#include "bench.h"
+#include "queue.h"
+#include "ring.h"
+#include "semaphore.h"
+
+#define QUEUE_LENGTH    32
+#define MAX_ELEMENT     64
+#define ITERATIONS      1000000
+
+static const uint32_t elementSizes[] = { 1, 4, 8, 16, 64 };
+
+#define NUM_SIZES (sizeof(elementSizes) / sizeof(elementSizes[0]))
+
+static uint64_t storage[(QUEUE_LENGTH * MAX_ELEMENT) / sizeof(uint64_t)];
+static uint64_t in[MAX_ELEMENT / sizeof(uint64_t)];
+static uint64_t out[MAX_ELEMENT / sizeof(uint64_t)];
+
+static void CopyByteLoop(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    uintd_t i;
+
+    for(i = 0; i < size; i++)
+    {
+        dest[i] = src[i];
+    }
+}
+
+static void BenchEnqueueDequeue(const char* benchmark, uint32_t size, uint32_t length, bool byteLoop)
+{
+    uint32_t    j;
+    Queue_t     queue;
+    BenchTime_t start;
+    BenchTime_t total = { 0, 0 };
+
+    InitQueue(&queue, (uint8_t*)storage, size, length);
+
+    if(byteLoop)
+    {
+        queue.copy = CopyByteLoop;
+    }
+
+    // Keep the queue half full so the ring wraps around as we go
+    for(j = 0; j < length / 2; j++)
+    {
+        Enqueue(&queue, (uint8_t*)in);
+    }
+
+    BenchStart(&start);
+
+    for(j = 0; j < ITERATIONS; j++)
+    {
+        Enqueue(&queue, (uint8_t*)in);
+        Dequeue(&queue, (uint8_t*)out);
+    }
+
+    BenchStop(&start, &total);
+    BenchReportThroughput(benchmark, "bytes", size, ITERATIONS, 2 * size, &total);
+}
+
+static void BenchEnqueueDequeueMany(uint32_t batch)
+{
+    uint32_t    j;
+    Queue_t     queue;
+    BenchTime_t start;
+    BenchTime_t total = { 0, 0 };
+    uint32_t    iterations = ITERATIONS / batch;
+
+    InitQueue(&queue, (uint8_t*)storage, sizeof(uint32_t), QUEUE_LENGTH);
+
+    // Start part way round, so batches wrap
+    for(j = 0; j < QUEUE_LENGTH / 2 + 1; j++)
+    {
+        Enqueue(&queue, (uint8_t*)in);
+        Dequeue(&queue, (uint8_t*)out);
+    }
+
+    BenchStart(&start);
+
+    for(j = 0; j < iterations; j++)
+    {
+        EnqueueMany(&queue, (uint8_t*)in, batch);
+        DequeueMany(&queue, (uint8_t*)out, batch);
+    }
+
+    BenchStop(&start, &total);
+    BenchReportThroughput("enqueue_dequeue_many", "batch", batch, iterations * batch, 2 * sizeof(uint32_t), &total);
+}
+
+static void BenchRingPutGet(uint32_t size)
+{
+    uint32_t    j;
+    Ring_t      ring;
+    BenchTime_t start;
+    BenchTime_t total = { 0, 0 };
+
+    InitRing(&ring, (uint8_t*)storage, size, QUEUE_LENGTH);
+
+    for(j = 0; j < QUEUE_LENGTH / 2; j++)
+    {
+        RingPut(&ring, (uint8_t*)in);
+    }
+
+    BenchStart(&start);
+
+    for(j = 0; j < ITERATIONS; j++)
+    {
+        RingPut(&ring, (uint8_t*)in);
+        RingGet(&ring, (uint8_t*)out);
+    }
+
+    BenchStop(&start, &total);
+    BenchReportThroughput("ring_put_get", "bytes", size, ITERATIONS, 2 * size, &total);
+}
+
+static void BenchSemaphoreGiveTake()
+{
+    uint32_t    j;
+    Semaphore_t sem;
+    Queue_t     queue;
+    uint8_t     token = 0;
+    BenchTime_t start;
+    BenchTime_t total      = { 0, 0 };
+    BenchTime_t queueTotal = { 0, 0 };
+
+    InitSemaphore(&sem, 1);
+
+    BenchStart(&start);
+
+    for(j = 0; j < ITERATIONS; j++)
+    {
+        SemaphoreGive(&sem);
+        SemaphoreTake(&sem);
+    }
+
+    BenchStop(&start, &total);
+    BenchReport("semaphore_give_take", "count", 1, ITERATIONS, &total);
+
+    InitQueue(&queue, (uint8_t*)storage, sizeof(uint8_t), QUEUE_LENGTH);
+    Enqueue(&queue, &token);
+
+    BenchStart(&start);
+
+    for(j = 0; j < ITERATIONS; j++)
+    {
+        Enqueue(&queue, &token);
+        DequeueBlocking(&queue, &token);
+    }
+
+    BenchStop(&start, &queueTotal);
+    BenchReport("queue_give_take", "count", 1, ITERATIONS, &queueTotal);
+}
+
+void BenchQueue()
+{
+    uint32_t i;
+
+    for(i = 0; i < NUM_SIZES; i++)
+    {
+        BenchEnqueueDequeue("enqueue_dequeue", elementSizes[i], QUEUE_LENGTH, false);
+        BenchEnqueueDequeue("enqueue_dequeue_byte_loop", elementSizes[i], QUEUE_LENGTH, true);
+        BenchEnqueueDequeue("enqueue_dequeue_non_pow2", elementSizes[i], QUEUE_LENGTH - 1, false);
+        BenchRingPutGet(elementSizes[i]);
+    }
+
+    for(i = 1; i <= MAX_ELEMENT / sizeof(uint32_t); i *= 2)
+    {
+        BenchEnqueueDequeueMany(i);
+    }
+
+    BenchSemaphoreGiveTake();
+}
@@ -0,0 +1,146 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Scheduler benchmarks: the cost of Tick() as sleeping and time-sliced tasks are added, and of
+ * switching tasks as more priority levels are in use.
+ */
+
+#include "bench.h"
+#include "rtos.h"
+#include "task.h"
+
+#define MAX_TASKS       1000
+#define ITERATIONS      100000
+
+extern Task_t* CurrentTask;
+
+static Task_t tasks[MAX_TASKS];
+
+static const uint32_t taskCounts[] = { 1, 10, 100, 1000 };
+static const uint32_t priorityCounts[] = { 1, 8, 32, NUM_PRIORITY_LEVELS - 1 };
+
+#define NUM_COUNTS(a) (sizeof(a) / sizeof(a[0]))
+
+/*
+ * Put count tasks to sleep, long enough that none of them wake while we're timing
+ */
+static void SleepTasks(uint32_t count)
+{
+    uint32_t i;
+
+    RTOS_Initialize();
+
+    for(i = 0; i < count; i++)
+    {
+        BenchInitTask(&tasks[i], PRIORITY_1);
+
+        // Start the task, switch to it, then put it to sleep which switches back to the idle task
+        StartTask(&tasks[i]);
+        Tick();
+        DelayCurrentTask(ITERATIONS * 10 + (i * 7919) % MAX_TASKS);
+    }
+}
+
+/*
+ * Tick with every task asleep, only the idle task runs
+ */
+static void BenchTickSleepers()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS(taskCounts); i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        SleepTasks(taskCounts[i]);
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            Tick();
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("tick_sleepers", "sleepers", taskCounts[i], ITERATIONS, &total);
+    }
+}
+
+/*
+ * Tick with a number of ready tasks at the same priority, so every tick time-slices to the next one
+ */
+static void BenchTickTimeSlice()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS(taskCounts); i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        RTOS_Initialize();
+
+        for(j = 0; j < taskCounts[i]; j++)
+        {
+            BenchInitTask(&tasks[j], PRIORITY_1);
+            StartTask(&tasks[j]);
+        }
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            Tick();
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("tick_timeslice", "tasks", taskCounts[i], ITERATIONS, &total);
+    }
+}
+
+/*
+ * Ready the current task again and switch, with one task on each of a number of priority levels
+ */
+static void BenchSwitch()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS(priorityCounts); i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        RTOS_Initialize();
+
+        // Spread the tasks over the priority levels, lowest first
+        for(j = 0; j < priorityCounts[i]; j++)
+        {
+            BenchInitTask(&tasks[j], 1 + (j * (NUM_PRIORITY_LEVELS - 1)) / priorityCounts[i]);
+            StartTask(&tasks[j]);
+        }
+
+        Tick();
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            StartTask(CurrentTask);
+            SwitchToNextAvailableTask();
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("switch_next_task", "priorities", priorityCounts[i], ITERATIONS, &total);
+    }
+}
+
+void BenchScheduler()
+{
+    BenchTickSleepers();
+    BenchTickTimeSlice();
+    BenchSwitch();
+}
@@ -0,0 +1,151 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Software timer benchmarks: handling a timer interrupt, enabling/disabling a timer, and expiring timers
+ * one after another, as more timers are active.
+ */
+
+#include <string.h>
+#include "bench.h"
+#include "timer.h"
+
+#define ITERATIONS      100000
+
+// Fake hardware timer register, from test/port.c
+extern TIME timerReg;
+
+// Variables from timer.c
+extern TIME timeTimerSet;
+extern Timer_t* nextTimer;
+
+#define MAX_TIMERS      8192
+
+static Timer_t timers[MAX_TIMERS];
+
+static const uint32_t timerCounts[] = { 1, 16, 256, 4096, MAX_TIMERS - 1 };
+
+#define NUM_COUNTS (sizeof(timerCounts) / sizeof(timerCounts[0]))
+
+static void BenchCallback(void* arg){}
+
+/*
+ * Start count timers, all far enough out that they won't fire while we're timing
+ */
+static void StartTimers(uint32_t count)
+{
+    uint32_t i;
+
+    memset(timers, 0, sizeof(timers));
+    nextTimer    = NULL;
+    timerReg     = 0;
+    timeTimerSet = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        TimerStart(&timers[i], ITERATIONS * 10 + i, BenchCallback, NULL, false);
+    }
+}
+
+/*
+ * A hardware timer interrupt where no timer has expired yet
+ */
+static void BenchTimerInterrupt()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS; i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+
+        StartTimers(timerCounts[i]);
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            timerReg++;
+            TimerInterrupt();
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("timer_interrupt", "timers", timerCounts[i], ITERATIONS, &total);
+    }
+}
+
+/*
+ * Start then stop one timer that would be the next to fire
+ */
+static void BenchTimerEnableDisable()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS; i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+        Timer_t*    timer = &timers[timerCounts[i]];
+
+        StartTimers(timerCounts[i]);
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            TimerStart(timer, 1, BenchCallback, NULL, false);
+            TimerStop(timer);
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("timer_enable_disable", "timers", timerCounts[i], ITERATIONS, &total);
+    }
+}
+
+static void ReloadCallback(void* arg){}
+
+/*
+ * Every timer reloads with the same period, their deadlines spread evenly through it, so each interrupt
+ * expires exactly one timer while the rest wait
+ */
+static void BenchTimerExpire()
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < NUM_COUNTS; i++)
+    {
+        BenchTime_t start;
+        BenchTime_t total = { 0, 0 };
+        uint32_t    count = timerCounts[i];
+
+        memset(timers, 0, sizeof(timers));
+        nextTimer    = NULL;
+        timeTimerSet = 0;
+
+        for(j = 0; j < count; j++)
+        {
+            timerReg = j;
+            TimerStart(&timers[j], count, ReloadCallback, NULL, true);
+        }
+
+        BenchStart(&start);
+
+        for(j = 0; j < ITERATIONS; j++)
+        {
+            timerReg++;
+            TimerInterrupt();
+        }
+
+        BenchStop(&start, &total);
+        BenchReport("timer_expire", "timers", count, ITERATIONS, &total);
+    }
+}
+
+void BenchTimer()
+{
+    BenchTimerInterrupt();
+    BenchTimerEnableDisable();
+    BenchTimerExpire();
+}
@@ -0,0 +1,43 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Host microbenchmarks for the RTOS.
+ *
+ * These link against the host test port, built with optimization and bench/inc/config.h. Each benchmark
+ * times one kernel primitive while varying one parameter (number of tasks, priorities, sleepers, timers...),
+ * and reports every data point through BenchReport. Results are printed as a table, and also written as CSV
+ * so that runs can be compared to catch regressions.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include "config.h"
+#include "task.h"
+
+// Timestamp with both wall time and cycles, taken with BenchStart/BenchStop
+typedef struct _bench_time_t
+{
+    uint64_t ns;
+    uint64_t cycles;
+} BenchTime_t;
+
+uint64_t BenchNowNs();
+uint64_t BenchNowCycles();
+
+void BenchStart(BenchTime_t* time);
+void BenchStop(BenchTime_t* time, BenchTime_t* total);
+
+void BenchReport(const char* benchmark, const char* parameter, uint32_t value, uint32_t iterations, BenchTime_t* total);
+void BenchReportThroughput(const char* benchmark, const char* parameter, uint32_t value, uint32_t iterations,
+                           uint32_t bytesPerOp, BenchTime_t* total);
+
+void BenchInitTask(Task_t* task, uintd_t priority);
+
+void BenchScheduler();
+void BenchQueue();
+void BenchTimer();
+void BenchEvent();
+
+#endif /* BENCH_H_ */
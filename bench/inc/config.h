@@ -0,0 +1,86 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Configuration for the benchmarks. This is the host test configuration, but with enough
+ * priority levels and software timers to measure how the kernel scales with them.
+ */
+
+#ifndef CONFIG_H
+#define	CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SWITCH_TO_NEXT_INT ReleaseControl()
+
+#define ENTER_CRITICAL_SECTION
+#define EXIT_CRITICAL_SECTION
+
+void ReleaseControl();
+
+#ifndef	NULL
+    #define NULL (0)
+#endif	/* NULL */
+
+// Default size type (should be equal to width of processor)
+typedef uint32_t uintd_t;
+
+// Priority
+#define NUM_PRIORITY_LEVELS 64
+#define PRIORITY_0 0
+#define PRIORITY_1 1
+#define PRIORITY_2 2
+#define PRIORITY_3 3
+#define PRIORITY_4 4
+#define PRIORITY_5 5
+#define PRIORITY_6 6
+
+#define PRIORITY_IDLE PRIORITY_0
+
+// Count leading zeros of a non-zero uintd_t. The scheduler uses this to find the highest ready priority,
+// so it should map to a single instruction where the processor has one (e.g. clz on MIPS32).
+#define COUNT_LEADING_ZEROS(x) ((uintd_t)__builtin_clz(x))
+
+// Atomic accesses for the lock free ring buffer. Loads that acquire and stores that release are enough to pass
+// elements between one producer and one consumer, the fence orders a store before a following load.
+#define ATOMIC_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FENCE()              __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Compare and swap for semaphores: if *p equals *e, store d and return true. Otherwise copy *p to *e and return false.
+#define ATOMIC_COMPARE_EXCHANGE(p, e, d) __atomic_compare_exchange_n((p), (e), (d), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+// Stack
+#define DFLT_STACK_SIZE	200
+#define OS_STACK_SIZE	800
+
+// Blocking calls return straight away, as on the test port
+#define RUNTESTS
+
+typedef uintd_t TIME;
+#define TIMER_MAX  4294967295U // 32-bit uint max
+
+// Number of hardware timer counts in one tick
+#define TIMER_COUNTS_PER_TICK 100
+
+// Don't bother suppressing the tick unless at least this many ticks can be skipped
+#define TICKLESS_MIN_IDLE_TICKS 2
+
+extern TIME timerReg;
+#define READ_TIMER_REGISTER() timerReg
+
+#ifdef RUNTESTS
+    #define LOOP(b)
+#else
+    #define LOOP(b) while(b)
+#endif
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PORT_TYPES_H */
@@ -0,0 +1,171 @@
+// 2015 Adam Jesionowski
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef struct _benchmark_t
+{
+    const char* name;
+    void        (*run)(void);
+} Benchmark_t;
+
+static const Benchmark_t benchmarks[] =
+{
+    { "scheduler", BenchScheduler },
+    { "queue",     BenchQueue     },
+    { "timer",     BenchTimer     },
+    { "event",     BenchEvent     },
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// Machine readable results, NULL if not requested
+static FILE* results;
+
+/*
+ * Monotonic time in nanoseconds
+ */
+uint64_t BenchNowNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Processor cycle counter, where the host has one we can read. Otherwise this is always 0.
+ */
+uint64_t BenchNowCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+void BenchStart(BenchTime_t* time)
+{
+    time->ns     = BenchNowNs();
+    time->cycles = BenchNowCycles();
+}
+
+/*
+ * Add the time since BenchStart was called on time to total
+ */
+void BenchStop(BenchTime_t* time, BenchTime_t* total)
+{
+    uint64_t cycles = BenchNowCycles();
+    uint64_t ns     = BenchNowNs();
+
+    total->ns     += ns - time->ns;
+    total->cycles += cycles - time->cycles;
+}
+
+/*
+ * Report one data point: the average cost of one operation over iterations
+ */
+void BenchReport(const char* benchmark, const char* parameter, uint32_t value, uint32_t iterations, BenchTime_t* total)
+{
+    BenchReportThroughput(benchmark, parameter, value, iterations, 0, total);
+}
+
+/*
+ * As BenchReport, for operations that move bytesPerOp bytes each, also reporting bytes per second
+ */
+void BenchReportThroughput(const char* benchmark, const char* parameter, uint32_t value, uint32_t iterations,
+                           uint32_t bytesPerOp, BenchTime_t* total)
+{
+    double ns     = (double)total->ns / iterations;
+    double cycles = (double)total->cycles / iterations;
+    double bytesPerSec = 0;
+
+    if(total->ns != 0)
+    {
+        bytesPerSec = ((double)bytesPerOp * iterations * 1e9) / total->ns;
+    }
+
+    printf("%-28s %-12s %8u %12.2f %12.2f", benchmark, parameter, value, ns, cycles);
+
+    if(bytesPerOp != 0)
+    {
+        printf(" %14.0f", bytesPerSec);
+    }
+
+    printf("\n");
+
+    if(results != NULL)
+    {
+        fprintf(results, "%s,%s,%u,%u,%.3f,%.3f,%.0f\n", benchmark, parameter, value, iterations, ns, cycles, bytesPerSec);
+    }
+}
+
+/*
+ * Set up a task struct the way a task would be declared statically
+ */
+void BenchInitTask(Task_t* task, uintd_t priority)
+{
+    memset(task, 0, sizeof(Task_t));
+
+    task->priority       = priority;
+    task->taskList.owner = task;
+}
+
+/*
+ * Usage: HobbyOSBench.exe [results.csv] [benchmark...]
+ *
+ * With no benchmark names, everything is run.
+ */
+int main(int ac, char** av)
+{
+    uint32_t i;
+    int      j;
+
+    if(ac > 1)
+    {
+        results = fopen(av[1], "w");
+
+        if(results == NULL)
+        {
+            perror(av[1]);
+            return 1;
+        }
+
+        fprintf(results, "benchmark,parameter,value,iterations,ns_per_op,cycles_per_op,bytes_per_sec\n");
+    }
+
+    printf("%-28s %-12s %8s %12s %12s %14s\n", "benchmark", "parameter", "value", "ns/op", "cycles/op", "bytes/s");
+
+    for(i = 0; i < NUM_BENCHMARKS; i++)
+    {
+        bool run = (ac <= 2);
+
+        for(j = 2; j < ac; j++)
+        {
+            if(strcmp(av[j], benchmarks[i].name) == 0)
+            {
+                run = true;
+            }
+        }
+
+        if(run)
+        {
+            benchmarks[i].run();
+        }
+    }
+
+    if(results != NULL)
+    {
+        fclose(results);
+    }
+
+    return 0;
+}
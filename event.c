@@ -2,13 +2,159 @@
 
 #include "event.h"
 #include "rtos.h"
+#include "port.h"
+#include "task.h"
+#include "queueSet.h"
+
+/*
+ * Initialize the event, with no tasks waiting and not in a queue set
+ */
+void InitEvent(Event_t* event)
+{
+    InitList(&event->blockedTasks);
+    event->set = NULL;
+}
 
 void WaitForEvent(Event_t* event)
 {
     BlockCurrentTaskToList(&event->blockedTasks);
 }
 
+/*
+ * Wait for the event, for up to the passed number of ticks. Returns true if the event wasn't triggered in time.
+ */
+bool WaitForEventTimeout(Event_t* event, uintd_t ticks)
+{
+    Task_t* self = GetCurrentTask();
+
+    if(ticks == 0)
+    {
+        return true;
+    }
+
+    BlockCurrentTaskToListTimeout(&event->blockedTasks, ticks);
+
+    // By the time we get here again, either the event was triggered or we ran out of time
+    return self->timedOut;
+}
+
 void TriggerEvent(Event_t* event)
 {
     ReadyTaskEntireList(&event->blockedTasks);
+
+    if(event->set != NULL)
+    {
+        QueueSetPost(event->set, event, 1);
+    }
+}
+
+/*
+ * Initialize the group, with no bits set and no tasks waiting
+ */
+void InitEventGroup(EventGroup_t* group)
+{
+    group->bits = 0;
+    InitList(&group->blockedTasks);
+}
+
+/*
+ * Whether bits meets a wait for any or all of mask
+ */
+static bool BitsMet(uintd_t bits, uintd_t mask, bool all)
+{
+    return all ? ((bits & mask) == mask) : ((bits & mask) != 0);
+}
+
+/*
+ * Wait until any (or, if all is true, every one) of the bits in mask are set in the group. If clearOnExit
+ * is true, those bits are cleared once the wait is met. Returns the group's bits as they were when it was met.
+ */
+uintd_t WaitBits(EventGroup_t* group, uintd_t mask, bool all, bool clearOnExit)
+{
+    Task_t* task = GetCurrentTask();
+    uintd_t bits;
+    bool    blocked = false;
+
+    ENTER_CRITICAL_SECTION;
+
+    bits = group->bits;
+
+    if(BitsMet(bits, mask, all))
+    {
+        if(clearOnExit)
+        {
+            group->bits &= ~mask;
+        }
+    }
+    else
+    {
+        // SetBits checks these against the group, and leaves the bits that met them in eventBits
+        task->eventBits    = mask;
+        task->eventWaitAll = all;
+        task->eventClear   = clearOnExit;
+
+        blocked = true;
+        BlockCurrentTaskToList(&group->blockedTasks);
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    if(blocked)
+    {
+        bits = task->eventBits;
+    }
+
+    return bits;
+}
+
+/*
+ * Set bits in the group, readying each waiting task whose wait is now met. Can be called from an interrupt.
+ * Returns true if any task was readied.
+ */
+bool SetBits(EventGroup_t* group, uintd_t bits)
+{
+    List_t* list;
+    uintd_t clear = 0;
+    bool    readied = false;
+
+    ENTER_CRITICAL_SECTION;
+
+    group->bits |= bits;
+    list = group->blockedTasks.head;
+
+    while(list != NULL)
+    {
+        Task_t* task = (Task_t*)list->owner;
+        List_t* next = list->next;
+
+        if(BitsMet(group->bits, task->eventBits, task->eventWaitAll))
+        {
+            if(task->eventClear)
+            {
+                clear |= task->eventBits;
+            }
+
+            task->eventBits = group->bits;
+            ReadyTask(&group->blockedTasks, task);
+            readied = true;
+        }
+
+        list = next;
+    }
+
+    // Clear afterwards, so that every task met above sees the same bits
+    group->bits &= ~clear;
+
+    EXIT_CRITICAL_SECTION;
+
+    return readied;
+}
+
+void ClearBits(EventGroup_t* group, uintd_t bits)
+{
+    ENTER_CRITICAL_SECTION;
+
+    group->bits &= ~bits;
+
+    EXIT_CRITICAL_SECTION;
 }
@@ -3,6 +3,7 @@
 #include "idleTask.h"
 #include "config.h"
 #include "port.h"
+#include "rtos.h"
 
 static uintd_t IdleTask_stack[DFLT_STACK_SIZE];
 
@@ -22,7 +23,12 @@ void IdleTask_init()
 
 void IdleTask_main()
 {
-    // Potentially this could be replaced with 'hlt' or some other portable power down thing
+    // Without tickless idle, potentially this could be replaced with 'hlt' or some other portable power down thing
     // For now, just leave it as this
-    while(1);
+    while(1)
+    {
+#ifdef TICKLESS_IDLE
+        TicklessIdle();
+#endif
+    }
 }
@@ -5,11 +5,22 @@
  *
  * A task will call WaitForEvent and be blocked until the event producer
  * calls TriggerEvent. In this regard, they act like queues that don't pass data.
+ *
+ * WaitForEventTimeout gives up after a number of ticks, returning true if it did.
+ *
+ * An Event_t must be set up with InitEvent, or start out zeroed, before it's used. The same goes for an
+ * EventGroup_t and InitEventGroup.
+ *
+ * Event groups hold a set of bits, one for each condition. A task calls WaitBits to wait until any or all
+ * of the bits in its mask are set, optionally clearing them again when it's done waiting. SetBits, from
+ * a task or an interrupt, readies only the tasks whose wait it meets. Every task met by the same SetBits
+ * sees the bits before any are cleared.
  */
 
 #ifndef EVENT_H_
 #define EVENT_H_
 
+#include "config.h"
 #include "list.h"
 
 #ifdef	__cplusplus
@@ -18,11 +29,24 @@ extern "C" {
 
 typedef struct _event_t
 {
-    List_t* blockedTasks;
+    ListHead_t blockedTasks;
+    struct _queue_set_t* set;   // The queue set told about each trigger, or NULL. See queueSet.h.
 } Event_t;
 
+typedef struct _event_group_t
+{
+    uintd_t    bits;
+    ListHead_t blockedTasks;
+} EventGroup_t;
+
+void InitEvent(Event_t* event);
 void WaitForEvent(Event_t* event);
+bool WaitForEventTimeout(Event_t* event, uintd_t ticks);
 void TriggerEvent(Event_t* event);
+void InitEventGroup(EventGroup_t* group);
+uintd_t WaitBits(EventGroup_t* group, uintd_t mask, bool all, bool clearOnExit);
+bool SetBits(EventGroup_t* group, uintd_t bits);
+void ClearBits(EventGroup_t* group, uintd_t bits);
 
 #ifdef	__cplusplus
 }
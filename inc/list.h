@@ -6,6 +6,9 @@
  * Note that List_ts are meant to be a members of a larger struct, which the owner
  * field points back to. This allows the list owner to know what task, e.g., the list
  * element is associated with.
+ *
+ * A list itself is a ListHead_t, which tracks both ends of the list so that adding to the
+ * front or the end and removing from the front are all constant time.
  */
 
 #ifndef LIST_H
@@ -24,11 +27,19 @@ typedef struct _list_t
     void*           owner;  // List_t structs are implemented be a part of a larger data structure, which this points to
 } List_t;
 
-void AppendToList(List_t** root, List_t* node);
-void AppendToEndOfList(List_t** root, List_t* node);
-void RemoveFromList(List_t** root, List_t* node);
-void RemoveFront(List_t** root);
-bool IsNodeInList(List_t** root, List_t* node);
+typedef struct _list_head_t
+{
+    List_t* head;   // First node in the list, NULL if the list is empty
+    List_t* tail;   // Last node in the list, NULL if the list is empty
+} ListHead_t;
+
+void InitList(ListHead_t* list);
+void AppendToList(ListHead_t* list, List_t* node);
+void AppendToEndOfList(ListHead_t* list, List_t* node);
+void InsertBeforeInList(ListHead_t* list, List_t* position, List_t* node);
+void RemoveFromList(ListHead_t* list, List_t* node);
+void RemoveFront(ListHead_t* list);
+bool IsNodeInList(ListHead_t* list, List_t* node);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,48 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Mutexes give one task at a time ownership of a shared resource.
+ *
+ * A task that calls MutexLock while another task owns the mutex blocks until it's unlocked. Waiting tasks
+ * are kept in priority order, and MutexUnlock hands ownership straight to the highest priority one, so a
+ * task never wakes to find the mutex taken again. The new owner runs as soon as it's the highest priority
+ * ready task, as with queues and events.
+ *
+ * While a task waits, the owner inherits its priority, so that medium priority tasks can't keep the owner
+ * from running and unlocking. If the owner is blocked, on a queue, semaphore or anything else, it moves up
+ * that list too, so it's woken ahead of the tasks it now outranks. If the owner is itself waiting on another
+ * mutex, that mutex's owner inherits the priority as well. When the owner unlocks, it drops back to the
+ * highest priority of the tasks still waiting on mutexes it holds, or its own priority.
+ *
+ * Mutexes don't nest, a task that locks a mutex it already owns blocks forever. Only the owner may unlock.
+ * A Mutex_t must be set up with InitMutex, or start out zeroed, before it's used.
+ */
+
+#ifndef MUTEX_H_
+#define MUTEX_H_
+
+#include "config.h"
+#include "list.h"
+#include "task.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct _mutex_t
+{
+    Task_t*    owner;           // The task that has the mutex locked, NULL if it's unlocked
+    List_t     heldList;        // Places the mutex on its owner's mutexesHeld list
+    ListHead_t blockedTasks;    // Tasks waiting to lock the mutex, highest priority first
+} Mutex_t;
+
+void InitMutex(Mutex_t* mutex);
+void MutexLock(Mutex_t* mutex);
+bool MutexTryLock(Mutex_t* mutex);
+bool MutexUnlock(Mutex_t* mutex);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* MUTEX_H_ */
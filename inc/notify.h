@@ -0,0 +1,42 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Notifications signal one known task without needing a queue or event between them.
+ *
+ * Every task has a notification word. NotifyTask changes it, by setting bits, incrementing it or overwriting
+ * it, marks a notification as pending and readies the task if it's waiting. A task calls WaitNotify to wait
+ * for a pending notification, which returns the word and clears the passed bits from it.
+ *
+ * The task waits on its own list, so NotifyTask never has to look through other tasks. It can be called
+ * from interrupts, and returns whether it readied the task so the interrupt can call
+ * SwitchToHighestPriorityTaskFromISR.
+ *
+ * Only the task itself should wait for its notifications.
+ */
+
+#ifndef NOTIFY_H_
+#define NOTIFY_H_
+
+#include "config.h"
+#include "task.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef enum _notify_action_t
+{
+    NOTIFY_SET_BITS,        // OR value into the word
+    NOTIFY_INCREMENT,       // Add one to the word, value is unused
+    NOTIFY_OVERWRITE        // Replace the word with value
+} NotifyAction_t;
+
+bool NotifyTask(Task_t* task, uintd_t value, NotifyAction_t action);
+uintd_t WaitNotify(uintd_t clearBits);
+bool WaitNotifyTimeout(uintd_t clearBits, uintd_t ticks, uintd_t* value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* NOTIFY_H_ */
@@ -10,7 +10,12 @@ void InitTickTimer();
 void InitSoftwareInterrupt();
 
 volatile uintd_t* InitStack(volatile uintd_t* StackPtr, void* func);
+void StartFirstTask();
 
 void PortStartHardwareTimer(TIME time);
 
+// Stops the tick and sleeps for at most the passed number of ticks, or until another interrupt occurs.
+// Returns how many whole ticks passed while asleep, which the tick interrupt did not count.
+uintd_t PortSuppressTicks(uintd_t ticks);
+
 #endif /* PORT_H_ */
@@ -15,8 +15,29 @@
  * there was room for new data/data available for enqueue and dequeue respectively.
  *
  * Blocking operations cause the task calling the function to wait until there is room for
- * data or for data to be available. Note that timeouts for these functions are currently not
- * implemented, so care should be taken when using them.
+ * data or for data to be available. EnqueueBlockingTimeout and DequeueBlockingTimeout give up after
+ * a number of ticks, returning true if they did.
+ *
+ * When a task is blocked on a queue, only the highest priority waiting task is woken by an operation,
+ * and the data is copied straight to (or from) that task's buffer, so a woken task never re-blocks.
+ *
+ * Elements are copied with a function chosen when the queue is initialized. Sizes of 1, 2, 4 and 8 bytes get a
+ * fixed size copy, and elements that are a whole number of words stored in word aligned storage are copied a word
+ * at a time. Anything else uses memcpy.
+ *
+ * Indexing is cheapest when both the number of elements and the element size are powers of two, as
+ * positions then wrap with a mask and are turned into byte offsets with a shift, rather than needing a
+ * divide and multiply for every operation.
+ *
+ * Bursts of elements can be moved with EnqueueMany and DequeueMany, which take a single critical section and
+ * wake waiting tasks once for the whole batch. Their blocking versions wait until at least a minimum number
+ * of elements have been moved.
+ *
+ * Large elements can be written and read in place, avoiding the copies Enqueue and Dequeue make.
+ * A producer calls QueueReserve to get a pointer to the next free slot, fills it, then calls QueueCommit.
+ * A consumer calls QueuePeekAcquire to get a pointer to the front element, reads it, then calls QueueRelease.
+ * Only one slot can be reserved and one element acquired at a time, and while they are, other enqueues
+ * and dequeues respectively are refused (or block), so keep the time between the two calls short.
  *
  */
 
@@ -30,6 +51,9 @@
 extern "C" {
 #endif
 
+// Copies a single element of size bytes. InitQueue picks one to suit the queue's element size and alignment.
+typedef void (*QueueCopy_t)(uint8_t* dest, uint8_t* src, uintd_t size);
+
 typedef struct _queue_t
 {
     uint8_t* start;                 // A pointer to the storage area
@@ -38,9 +62,20 @@ typedef struct _queue_t
     uintd_t  maxSize;               // The maximum number of elements that can be stored in the queue
     uintd_t  front;                 // The front of the queue (represented as an integer position in the queue, not a pointer)
     uintd_t  sizeOf;                // The size in bytes of the queue's content
+    QueueCopy_t copy;               // How elements are copied in and out of the queue
+
+    bool     pow2Size;              // maxSize is a power of two, so positions wrap with mask rather than a divide
+    bool     pow2SizeOf;            // sizeOf is a power of two, so byte offsets are found with shift rather than a multiply
+    uintd_t  mask;                  // maxSize - 1, only used if pow2Size
+    uintd_t  shift;                 // log2(sizeOf), only used if pow2SizeOf
+
+    bool     reserved;              // The slot at the tail has been handed out by QueueReserve
+    bool     acquired;              // The front element has been handed out by QueuePeekAcquire
+
+    ListHead_t tasksBlockedOnRead;  // A list of tasks that are waiting for data that they can dequeue
+    ListHead_t tasksBlockedOnWrite; // A list of tasks that are waiting for space to enqueue data
 
-    List_t*  tasksBlockedOnRead;    // A list of tasks that are waiting for data that they can dequeue
-    List_t*  tasksBlockedOnWrite;   // A list of tasks that are waiting for space to enqueue data
+    struct _queue_set_t* set;       // The queue set told about each element added, or NULL. See queueSet.h.
 } Queue_t;
 
 void InitQueue(Queue_t* queue, uint8_t* start, uintd_t sizeOf, uintd_t maxSize);
@@ -48,6 +83,18 @@ bool Enqueue(Queue_t* queue, uint8_t* src);
 bool Dequeue(Queue_t* queue, uint8_t* dest);
 void EnqueueBlocking(Queue_t* queue, uint8_t* src);
 void DequeueBlocking(Queue_t* queue, uint8_t* dest);
+bool EnqueueBlockingTimeout(Queue_t* queue, uint8_t* src, uintd_t ticks);
+bool DequeueBlockingTimeout(Queue_t* queue, uint8_t* dest, uintd_t ticks);
+uintd_t EnqueueMany(Queue_t* queue, uint8_t* src, uintd_t n);
+uintd_t DequeueMany(Queue_t* queue, uint8_t* dest, uintd_t n);
+uintd_t EnqueueManyBlocking(Queue_t* queue, uint8_t* src, uintd_t n, uintd_t min);
+uintd_t DequeueManyBlocking(Queue_t* queue, uint8_t* dest, uintd_t n, uintd_t min);
+uint8_t* QueueReserve(Queue_t* queue);
+uint8_t* QueueReserveBlocking(Queue_t* queue);
+void QueueCommit(Queue_t* queue);
+uint8_t* QueuePeekAcquire(Queue_t* queue);
+uint8_t* QueuePeekAcquireBlocking(Queue_t* queue);
+void QueueRelease(Queue_t* queue);
 bool QueueIsEmpty(Queue_t* queue);
 bool QueueIsFull(Queue_t* queue);
 
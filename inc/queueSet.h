@@ -0,0 +1,49 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Queue sets let one task wait on several queues and events at once.
+ *
+ * A set is itself a queue, holding pointers to its members. Each element added to a member queue, and each
+ * trigger of a member event, adds the member to the set. WaitAny blocks until the set has a member in it and
+ * returns that member, a Queue_t* or Event_t*, for the caller to compare against its own. For a queue, the
+ * caller then takes one element from it with Dequeue. For an event, returning it is the whole trigger.
+ *
+ * As with queues, the set needs storage allocated for it:
+ *
+ * #define  SET_SIZE 10
+ * void*    setStorage[SET_SIZE];
+ * setStorage is then passed as the storage argument in InitQueueSet
+ *
+ * The set should be big enough to hold an entry for every element of every member queue, plus one for each
+ * event, otherwise a member that becomes readable while the set is full is lost. Members should only be read
+ * after WaitAny has returned them, and only by the task waiting on the set, so that each entry in the set
+ * still has its element behind it. A queue or event can be in at most one set.
+ */
+
+#ifndef QUEUESET_H_
+#define QUEUESET_H_
+
+#include "config.h"
+#include "queue.h"
+#include "event.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct _queue_set_t
+{
+    Queue_t ready;  // The members that have become readable, once for each element or trigger
+} QueueSet_t;
+
+void InitQueueSet(QueueSet_t* set, void** storage, uintd_t size);
+void QueueSetAddQueue(QueueSet_t* set, Queue_t* queue);
+void QueueSetAddEvent(QueueSet_t* set, Event_t* event);
+void QueueSetPost(QueueSet_t* set, void* member, uintd_t n);
+void* WaitAny(QueueSet_t* set);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* QUEUESET_H_ */
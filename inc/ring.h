@@ -0,0 +1,56 @@
+// 2015 Adam Jesionowski
+
+/*
+ * A lock free ring buffer for passing data from a single producer to a single consumer, typically from
+ * an interrupt to a task.
+ *
+ * Unlike Queue_t, RingPut and RingGet never enter a critical section. The producer only ever writes head and the
+ * consumer only ever writes tail, both as free running counts, so each side just needs to see the other's
+ * updates in order. The number of elements must be a power of two so positions can be found with a mask.
+ *
+ * The consumer may block in RingGetBlocking. It sets consumerWaiting before checking for data one last time,
+ * and the producer checks consumerWaiting after publishing an element, so between them the consumer is always
+ * either seen to be waiting or sees the new element. The producer only has to wake the consumer when the ring
+ * goes from empty to non-empty, as that is the only time the consumer can be waiting.
+ *
+ * As with queues, storage is allocated by the caller:
+ *
+ * #define  RING_SIZE 64
+ * uint8_t  rStorage[RING_SIZE];
+ * InitRing(&ring, rStorage, sizeof(uint8_t), RING_SIZE);
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include "config.h"
+#include "list.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct _ring_t
+{
+    uint8_t* start;                 // A pointer to the storage area
+    uintd_t  mask;                  // The number of elements in the storage area, minus one
+    uintd_t  sizeOf;                // The size in bytes of each element
+
+    uintd_t  head;                  // Count of elements put, only written by the producer
+    uintd_t  tail;                  // Count of elements taken, only written by the consumer
+    bool     consumerWaiting;       // The consumer is blocked, or about to block, in RingGetBlocking
+
+    ListHead_t blockedTasks;        // The consumer task, while it's blocked
+} Ring_t;
+
+bool InitRing(Ring_t* ring, uint8_t* start, uintd_t sizeOf, uintd_t size);
+bool RingPut(Ring_t* ring, uint8_t* src);
+bool RingGet(Ring_t* ring, uint8_t* dest);
+void RingGetBlocking(Ring_t* ring, uint8_t* dest);
+uintd_t RingCount(Ring_t* ring);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* RING_H_ */
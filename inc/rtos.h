@@ -12,6 +12,13 @@
  * If the current task has the same priority as a waiting task or tasks and there are no other higher priority tasks,
  * the RTOS will switch to the first waiting task, and put the current task at the end of the waiting task list.
  * Time-slicing is implemented in this way.
+ *
+ * Tasks blocked on a list are kept in priority order, highest first, so that the most important waiter
+ * can be readied on its own with ReadyHighestPriorityTask.
+ *
+ * A task blocked with a timeout is on SleepingTasks as well as the list it's blocked on. If it sleeps out its
+ * timeout first, UpdateSleeping takes it off the blocked list and sets its timedOut flag. If it's readied from the
+ * blocked list first, its timeout is removed from SleepingTasks.
  */
 
 #ifndef RTOS_H_
@@ -25,13 +32,28 @@
 extern "C" {
 #endif
 
+// The longest possible delay, used when there is nothing to wake up for. As a timeout, it means wait forever.
+#define MAX_DELAY_TICKS ((uintd_t)-1)
+
 void RTOS_Initialize();
 void StartTask(Task_t* task);
 void Tick();
 void DelayCurrentTask(uintd_t ticks);
+bool DelayCurrentTaskUntil(uint64_t wakeTick);
+bool DelayUntil(uint64_t* lastWake, uintd_t period);
 void UpdateSleeping();
-void BlockCurrentTaskToList(List_t** blockList);
-void ReadyTaskEntireList(List_t** taskList);
+uintd_t GetTickCount();
+uint64_t GetTickCount64();
+uintd_t TicksUntilNextWake();
+void AdvanceTicks(uintd_t ticks);
+void TicklessIdle();
+Task_t* GetCurrentTask();
+void BlockCurrentTaskToList(ListHead_t* blockList);
+void BlockCurrentTaskToListTimeout(ListHead_t* blockList, uintd_t ticks);
+void ReadyTaskEntireList(ListHead_t* taskList);
+Task_t* ReadyHighestPriorityTask(ListHead_t* taskList);
+void ReadyTask(ListHead_t* taskList, Task_t* task);
+void SetTaskPriority(Task_t* task, uintd_t priority);
 void SwitchToNextAvailableTask();
 void SwitchToHighestPriorityTaskFromISR();
 
@@ -0,0 +1,44 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Counting semaphores.
+ *
+ * SemaphoreTake takes one unit, blocking while there are none, and SemaphoreGive returns one. When nobody
+ * has to wait, taking and giving are a compare and swap on the count, with no critical section.
+ *
+ * A negative count is the number of tasks waiting. A taker that finds no units decrements the count and
+ * blocks inside one critical section, so a giver that sees the count was negative always finds it on the
+ * list. The giver hands its unit straight to the highest priority waiter, which runs as soon as it's the
+ * highest priority ready task.
+ *
+ * SemaphoreGiveFromISR can be called from interrupts, and returns whether it readied a task so the
+ * interrupt can call SwitchToHighestPriorityTaskFromISR.
+ */
+
+#ifndef SEMAPHORE_H_
+#define SEMAPHORE_H_
+
+#include "config.h"
+#include "list.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct _semaphore_t
+{
+    int32_t    count;           // Units available, or minus the number of waiting tasks
+    ListHead_t blockedTasks;    // Tasks waiting for a unit, highest priority first
+} Semaphore_t;
+
+void InitSemaphore(Semaphore_t* sem, int32_t count);
+void SemaphoreTake(Semaphore_t* sem);
+bool SemaphoreTryTake(Semaphore_t* sem);
+void SemaphoreGive(Semaphore_t* sem);
+bool SemaphoreGiveFromISR(Semaphore_t* sem);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* SEMAPHORE_H_ */
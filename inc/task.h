@@ -16,11 +16,28 @@
 extern "C" {
 #endif
 
+struct _mutex_t;
+
 typedef struct _task_t {
     uintd_t   priority;             // The task's priority level, with 0 being the lowest
     List_t    taskList;             // This list element is used to place the task on ready/sleeping/blocked lists
-    uintd_t   sleepTimer;           // Used for delaying the task with DelayCurrentTask
+    uintd_t   sleepTimer;           // Ticks to sleep after the task in front of this one on SleepingTasks wakes
     volatile uintd_t*  stackPtr;   // Pointer to the task's stack
+    uint8_t*  waitData;             // Data a blocked queue operation is waiting to hand off, set to NULL once it has been
+    List_t    timeoutList;          // Places the task on SleepingTasks while it's blocked with a timeout
+    ListHead_t* blockedOn;          // The list the task is blocked on, otherwise NULL
+    bool      timeoutRunning;       // Set while timeoutList is on SleepingTasks
+    bool      ready;                // Set while taskList is on a ready list
+    bool      timedOut;             // Set if the task's last blocking call with a timeout ran out of time
+    uintd_t   basePriority;         // The priority the task was started with, priority is raised above it while it holds a mutex a higher priority task wants
+    ListHead_t mutexesHeld;         // The mutexes the task has locked
+    struct _mutex_t* waitingOn;     // The mutex the task is blocked on, otherwise NULL
+    uintd_t   eventBits;            // The bits the task is waiting for on an event group, then the group's bits when they were set
+    bool      eventWaitAll;         // Whether the task needs all of eventBits, or any one of them
+    bool      eventClear;           // Whether to clear eventBits from the group once the task's wait is met
+    uintd_t   notifyValue;          // The task's notification word, see notify.h
+    bool      notifyPending;        // Set by NotifyTask, cleared when the task takes the notification
+    ListHead_t notifyWait;          // The task blocks here while it waits for a notification
 } Task_t;
 
 
@@ -6,15 +6,35 @@
  * implementation). In the PIC32 implementation, this means events can trigger with ~50 ns precision
  * (truthfully much less, as RTOS overhead is ~8 us).
  *
- * When the timer fires, it will call the passed timerCallback function. If reload is True, it will
- * automatically reload the timer, otherwise the timer will then be disabled.
+ * When the timer fires, it will call the passed timerCallback function with the passed argument, so the
+ * same callback can serve several timers. If reload is True, it will automatically reload the timer,
+ * otherwise the timer will then be stopped.
+ *
+ * Reloading timers keep to the period they were started with: each deadline is the previous deadline plus the
+ * period, so however late the interrupt runs, the timer doesn't drift. If a whole period or more is missed,
+ * those periods are skipped rather than fired back to back, and TimerMissedPeriods counts them.
+ *
+ * A timer can be given slack with TimerSetSlack, allowing it to fire up to that many counts after its deadline.
+ * The hardware timer is then set for the latest time that keeps every timer within its window, and all timers
+ * whose deadline has passed by then fire in that one interrupt. TimerInterruptsSaved counts the interrupts
+ * this avoids. Timers never fire before their deadline.
  *
  * Setting times are hardware specific, as they represent hardware timer counts.
  *
  * When writing callback functions, it's important to remember that they occur on the OS stack,
- * not associated with any task.
+ * not associated with any task. If TIMER_DAEMON is defined and the daemon is started, callbacks are instead
+ * called from the timer daemon task (see timerDaemon.h), except for timers started with TimerStartISR.
+ *
+ * Timers are owned by the caller, which declares a Timer_t (usually statically) and passes it to TimerStart.
+ * The Timer_t must stay in place until the timer has fired or been stopped. Nothing needs initializing
+ * beforehand, other than the Timer_t starting out zeroed.
  *
- * To create a new timer, add it to the SW_TIMER enum in config.h.
+ * Active timers are kept in a heap ordered by deadline, so the next timer to fire is always known, and only
+ * timers that have expired are looked at when the hardware timer interrupt occurs.
+ *
+ * Deadlines are kept on a 64-bit clock, the hardware timer count extended so that it doesn't wrap around.
+ * GetClock reads it, from tasks or interrupts, for timestamps. TimerStartAt takes an absolute deadline on
+ * this clock, which may be any distance away.
  *
  * Based on Implementing Software Timers, Don Libes
  * http://www.kohala.com/start/libes.timers.txt
@@ -30,21 +50,41 @@
 extern "C" {
 #endif
 
-// Timer callbacks take no values and return nothing.
-typedef void (*timerCallback)(void);
+// The 64-bit clock, in hardware timer counts
+typedef uint64_t TIME64;
+
+// Timer callbacks are passed the argument given to TimerStart, and return nothing.
+typedef void (*timerCallback)(void* arg);
 
 typedef struct _timer_t
 {
 	bool            isActive;       // Whether the timer being used or not
 	bool            reload;         // If true, this timer will continually fire
-	TIME            timeLeft;       // Time left on the timer
-	TIME            originalTime;   // Value passed when TimerEnable is called, used if reload is true
-	timerCallback	callback;       // Function called when timeLeft reaches zero
+	bool            inISR;          // If true, the callback is called from the interrupt even with the timer daemon
+	TIME64          deadline;       // Clock count at which the timer fires
+	TIME            slack;          // How many counts after the deadline the timer may fire, see TimerSetSlack
+	TIME            originalTime;   // Value passed when TimerStart is called, used if reload is true
+	uintd_t         missed;         // Periods skipped by a reloading timer that fell more than a period behind
+	timerCallback	callback;       // Function called when the deadline is reached
+	void*           arg;            // Passed to the callback
+
+	struct _timer_t* child;         // The timer heap links, see timer.c
+	struct _timer_t* sibling;
+	struct _timer_t* prev;
 } Timer_t;
 
-void TimerEnable(SW_TIMER timer, TIME time, timerCallback callback, bool reload);
-void TimerDisable(SW_TIMER timer);
+void TimerStart(Timer_t* timer, TIME time, timerCallback callback, void* arg, bool reload);
+void TimerStartISR(Timer_t* timer, TIME time, timerCallback callback, void* arg, bool reload);
+void TimerStartAt(Timer_t* timer, TIME64 deadline, timerCallback callback, void* arg);
+void TimerStartInCallback(Timer_t* timer, TIME time, timerCallback callback, void* arg, bool reload);
+void TimerStop(Timer_t* timer);
+TIME TimerTimeLeft(Timer_t* timer);
+uintd_t TimerMissedPeriods(Timer_t* timer);
+void TimerSetSlack(Timer_t* timer, TIME slack);
+uintd_t TimerInterruptsSaved();
+TIME64 GetClock();
 void TimerInterrupt();
+uintd_t TimerTicksUntilNext();
 
 // These are exposed for testing purposes.
 void TimerUpdate();
@@ -0,0 +1,60 @@
+// 2015 Adam Jesionowski
+
+/*
+ * The timer daemon is an optional task that runs software timer callbacks outside of the timer interrupt.
+ * When TIMER_DAEMON is defined and the daemon has been started, TimerUpdate posts each expired timer's
+ * callback to the daemon's queue rather than calling it, and the daemon calls it at TIMER_DAEMON_PRIORITY.
+ * A slow callback then only delays tasks of lower priority than the daemon, instead of every interrupt
+ * and the tick.
+ *
+ * Callbacks that need to run in the interrupt (because they must be on time, or can't wait for the daemon
+ * to be scheduled) can still be started with TimerStartISR.
+ *
+ * If the daemon's queue is full when a timer expires, that callback is dropped and counted. Size
+ * TIMER_DAEMON_QUEUE_SIZE for the most callbacks that may be waiting at once.
+ *
+ * The port's timer interrupt must call SwitchToHighestPriorityTaskFromISR after TimerInterrupt, so that the
+ * daemon runs as soon as the interrupt returns rather than at the next tick.
+ *
+ * The daemon isn't started by RTOS_Initialize, call TimerDaemon_init after it and before StartFirstTask.
+ */
+
+#ifndef TIMERDAEMON_H_
+#define TIMERDAEMON_H_
+
+#include "config.h"
+#include "task.h"
+#include "timer.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifdef TIMER_DAEMON
+
+// What's posted to the daemon for each expired timer
+typedef struct _timer_call_t
+{
+    timerCallback   callback;
+    void*           arg;
+} TimerCall_t;
+
+extern Task_t timerDaemonTask;
+
+void TimerDaemon_init();
+void TimerDaemon_main();
+bool TimerDaemonPost(timerCallback callback, void* arg);
+bool TimerDaemonIsRunning();
+uintd_t TimerDaemonDropped();
+
+// These are exposed for testing purposes.
+void TimerDaemonService();
+void TimerDaemonReset();
+
+#endif /* TIMER_DAEMON */
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* TIMERDAEMON_H_ */
@@ -3,94 +3,109 @@
 #include "config.h"
 #include "list.h"
 
+/*
+ * Initialize a list to empty. A zeroed ListHead_t is also a valid empty list.
+ */
+void InitList(ListHead_t* list)
+{
+    list->head = NULL;
+    list->tail = NULL;
+}
+
 /*
  * Append a node to the front of the list
  */
-void AppendToList(List_t** root, List_t* node)
+void AppendToList(ListHead_t* list, List_t* node)
 {
-    if(*root == NULL)
+    if(list->head == NULL)
     {
-    	// If root is null, all we need to do is set next to NULL
+    	// If the list is empty, this node is also the tail
         node->next = NULL;
+        list->tail = node;
     }
     else
     {
-    	// If it isn't, then the old root now has this as its prev, and next is the old root
-        (*root)->prev = node;
-        node->next = *root;
+    	// If it isn't, then the old head now has this as its prev, and next is the old head
+        list->head->prev = node;
+        node->next = list->head;
     }
 
-    // prev will always be null as we're now root
+    // prev will always be null as we're now the head
     node->prev = NULL;
-    *root = node;
+    list->head = node;
 }
 
 /*
  * Append a node to the end of the list
  */
-void AppendToEndOfList(List_t** root, List_t* node)
+void AppendToEndOfList(ListHead_t* list, List_t* node)
 {
-    List_t* temp;
-
-    if(*root == NULL)
+    if(list->tail == NULL)
     {
-    	// If root is null, we're now root
+    	// If the list is empty, we're now the head
         node->prev = NULL;
-        *root = node;
+        list->head = node;
     }
     else
     {
-    	// Look for the end of the list
-    	temp = *root;
-
-    	while(temp->next != NULL)
-    	{
-            temp = temp->next;
-    	}
-
     	// Append to the old end of the list
-    	temp->next = node;
-    	node->prev = temp;
+        list->tail->next = node;
+        node->prev = list->tail;
     }
 
     // As we're at the end, next is always null
     node->next = NULL;
+    list->tail = node;
+}
+
+/*
+ * Insert a node directly in front of position, which must be in the list. If position is NULL,
+ * the node is appended to the end of the list.
+ */
+void InsertBeforeInList(ListHead_t* list, List_t* position, List_t* node)
+{
+    if(position == NULL)
+    {
+        AppendToEndOfList(list, node);
+    }
+    else if(position->prev == NULL)
+    {
+        AppendToList(list, node);
+    }
+    else
+    {
+        node->prev = position->prev;
+        node->next = position;
+        position->prev->next = node;
+        position->prev = node;
+    }
 }
 
 /*
  * Remove a node from the list.
  */
-void RemoveFromList(List_t** root, List_t* node)
+void RemoveFromList(ListHead_t* list, List_t* node)
 {
-    if(root != NULL)
+    if(list != NULL)
     {
         if(node->prev == NULL)
         {
-            if(node->next == NULL)
-            {
-                // This node is root and there are no more nodes, set root to null
-                *root = NULL;
-            }
-            else
-            {
-                // This node is root, set next node to root
-                *root = node->next;
-                node->next->prev = NULL;
-            }
+            // This node is the head, the next node (if any) takes its place
+            list->head = node->next;
+        }
+        else
+        {
+            node->prev->next = node->next;
+        }
+
+        if(node->next == NULL)
+        {
+            // This node is the tail, the previous node (if any) takes its place
+            list->tail = node->prev;
         }
         else
         {
-            if(node->next == NULL)
-            {
-                // If this was the old end of the list, set the node behind it to null
-                node->prev->next = NULL;
-            }
-            else
-            {
-            	// This node was in the middle of the list, remove references to it
-                node->prev->next = node->next;
-                node->next->prev = node->prev;
-            }
+            node->next->prev = node->prev;
         }
     }
     node->prev = NULL;
@@ -100,28 +115,28 @@ void RemoveFromList(List_t** root, List_t* node)
 /*
  * Shortcut for removing the front node of a list.
  */
-void RemoveFront(List_t** root)
+void RemoveFront(ListHead_t* list)
 {
-    RemoveFromList(root, *root);
+    RemoveFromList(list, list->head);
 }
 
 /*
  * Returns true if the node is in the given list
  */
-bool IsNodeInList(List_t** root, List_t* node)
+bool IsNodeInList(ListHead_t* list, List_t* node)
 {
-    List_t* list = *root;
+    List_t* it = list->head;
     bool found = false;
 
-    while(list != NULL)
+    while(it != NULL)
     {
-        if(list == node)
+        if(it == node)
         {
             found = true;
             break;
         }
 
-        list = list->next;
+        it = it->next;
     }
 
     return found;
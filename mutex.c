@@ -0,0 +1,151 @@
+// 2015 Adam Jesionowski
+
+#include "mutex.h"
+#include "rtos.h"
+#include "port.h"
+
+/*
+ * Make task the owner of an unlocked mutex
+ */
+static void TakeMutex(Mutex_t* mutex, Task_t* task)
+{
+    mutex->owner          = task;
+    mutex->heldList.owner = mutex;
+
+    AppendToList(&task->mutexesHeld, &mutex->heldList);
+}
+
+/*
+ * Raise the owner of the mutex to at least the passed priority. If the owner is blocked on another mutex,
+ * carry on down the chain of owners.
+ */
+static void InheritPriority(Mutex_t* mutex, uintd_t priority)
+{
+    while(mutex != NULL && mutex->owner->priority < priority)
+    {
+        Task_t* owner = mutex->owner;
+
+        // If the owner is blocked, this also moves it up the list it's blocked on
+        SetTaskPriority(owner, priority);
+
+        mutex = owner->waitingOn;
+    }
+}
+
+/*
+ * Returns the priority a task should run at, the highest of its own and those of the tasks waiting on
+ * mutexes it holds
+ */
+static uintd_t InheritedPriority(Task_t* task)
+{
+    uintd_t priority = task->basePriority;
+    List_t* list     = task->mutexesHeld.head;
+
+    while(list != NULL)
+    {
+        Mutex_t* mutex = (Mutex_t*)list->owner;
+
+        // Waiters are in priority order, so only the first matters
+        if(mutex->blockedTasks.head != NULL && ((Task_t*)mutex->blockedTasks.head->owner)->priority > priority)
+        {
+            priority = ((Task_t*)mutex->blockedTasks.head->owner)->priority;
+        }
+
+        list = list->next;
+    }
+
+    return priority;
+}
+
+/*
+ * Initialize the mutex, unlocked with no tasks waiting
+ */
+void InitMutex(Mutex_t* mutex)
+{
+    mutex->owner = NULL;
+    InitList(&mutex->blockedTasks);
+}
+
+/*
+ * Lock the mutex, blocking until it's unlocked if another task owns it
+ */
+void MutexLock(Mutex_t* mutex)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(mutex->owner == NULL)
+    {
+        TakeMutex(mutex, GetCurrentTask());
+    }
+    else
+    {
+        Task_t* task = GetCurrentTask();
+
+        // Lend the owner our priority until it unlocks. MutexUnlock hands the mutex to us directly,
+        // so by the time we run again we own it.
+        task->waitingOn = mutex;
+        InheritPriority(mutex, task->priority);
+
+        BlockCurrentTaskToList(&mutex->blockedTasks);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Lock the mutex if nobody owns it. Returns true, without blocking, if the mutex was already locked.
+ */
+bool MutexTryLock(Mutex_t* mutex)
+{
+    bool error = true;
+
+    ENTER_CRITICAL_SECTION;
+
+    if(mutex->owner == NULL)
+    {
+        TakeMutex(mutex, GetCurrentTask());
+        error = false;
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return error;
+}
+
+/*
+ * Unlock the mutex, passing it to the highest priority waiting task if there is one. Returns true if the
+ * current task doesn't own the mutex.
+ */
+bool MutexUnlock(Mutex_t* mutex)
+{
+    Task_t* task = GetCurrentTask();
+    bool error = true;
+
+    ENTER_CRITICAL_SECTION;
+
+    if(mutex->owner == task)
+    {
+        Task_t* next;
+
+        RemoveFromList(&task->mutexesHeld, &mutex->heldList);
+        mutex->owner = NULL;
+
+        // Give back any priority that was only lent for this mutex
+        SetTaskPriority(task, InheritedPriority(task));
+
+        next = ReadyHighestPriorityTask(&mutex->blockedTasks);
+
+        // The new owner is the highest priority waiter, so it doesn't need to inherit from the others
+        if(next != NULL)
+        {
+            next->waitingOn = NULL;
+            TakeMutex(mutex, next);
+        }
+
+        error = false;
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return error;
+}
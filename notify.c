@@ -0,0 +1,119 @@
+// 2015 Adam Jesionowski
+
+#include "notify.h"
+#include "rtos.h"
+#include "port.h"
+
+/*
+ * Notify the task, changing its notification word as the action says. Returns true if the task was waiting
+ * and has been readied.
+ */
+bool NotifyTask(Task_t* task, uintd_t value, NotifyAction_t action)
+{
+    bool readied;
+
+    ENTER_CRITICAL_SECTION;
+
+    switch(action)
+    {
+        case NOTIFY_SET_BITS:
+            task->notifyValue |= value;
+            break;
+
+        case NOTIFY_INCREMENT:
+            task->notifyValue++;
+            break;
+
+        case NOTIFY_OVERWRITE:
+            task->notifyValue = value;
+            break;
+    }
+
+    task->notifyPending = true;
+
+    // The task is the only thing that can be on its list
+    readied = (ReadyHighestPriorityTask(&task->notifyWait) != NULL);
+
+    EXIT_CRITICAL_SECTION;
+
+    return readied;
+}
+
+/*
+ * Take the pending notification, returning the word and clearing clearBits from it
+ */
+static uintd_t TakeNotification(Task_t* task, uintd_t clearBits)
+{
+    uintd_t value = task->notifyValue;
+
+    task->notifyValue  &= ~clearBits;
+    task->notifyPending = false;
+
+    return value;
+}
+
+/*
+ * Wait for a notification, then return the notification word and clear clearBits from it.
+ * Pass ~0 as clearBits to zero the word, or 0 to leave it.
+ */
+uintd_t WaitNotify(uintd_t clearBits)
+{
+    Task_t* task = GetCurrentTask();
+    uintd_t value;
+    bool    wait = true;
+
+    LOOP(wait)
+    {
+        ENTER_CRITICAL_SECTION;
+
+        wait = !task->notifyPending;
+
+        if(wait)
+        {
+            BlockCurrentTaskToList(&task->notifyWait);
+        }
+
+        EXIT_CRITICAL_SECTION;
+    }
+
+    // We only get here once NotifyTask has readied us
+    ENTER_CRITICAL_SECTION;
+
+    value = TakeNotification(task, clearBits);
+
+    EXIT_CRITICAL_SECTION;
+
+    return value;
+}
+
+/*
+ * As WaitNotify, for up to the passed number of ticks. Returns true if no notification came in time, otherwise
+ * the notification word is copied to value.
+ */
+bool WaitNotifyTimeout(uintd_t clearBits, uintd_t ticks, uintd_t* value)
+{
+    Task_t* task = GetCurrentTask();
+    bool    timedOut = true;
+
+    ENTER_CRITICAL_SECTION;
+
+    if(!task->notifyPending && ticks != 0)
+    {
+        BlockCurrentTaskToListTimeout(&task->notifyWait, ticks);
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    // Either a notification is pending by now, or the timeout ran out
+    ENTER_CRITICAL_SECTION;
+
+    if(task->notifyPending)
+    {
+        *value   = TakeNotification(task, clearBits);
+        timedOut = false;
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return timedOut;
+}
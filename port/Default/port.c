@@ -4,6 +4,7 @@
 #include "rtos.h"
 #include "idleTask.h"
 #include "task.h"
+#include "timer.h"
 
 uintd_t* InitStack(uintd_t* StackPtr, void* func)
 {
@@ -16,12 +17,22 @@ void PortStartHardwareTimer(TIME time)
 	// Start the hardware timer to interrupt in time counts
 }
 
+uintd_t PortSuppressTicks(uintd_t ticks)
+{
+	// Stop the tick interrupt, program a wakeup ticks from now, then sleep.
+	// After waking, restart the tick and return how many whole ticks passed.
+	return 0;
+}
+
 // These need to clear their flags
 
 // Have this be called by the timer compare interrupt
 void HardwareTimerInterrupt()
 {
     TimerInterrupt();
+
+    // A timer callback, or a callback posted to the timer daemon, may have readied a more important task
+    SwitchToHighestPriorityTaskFromISR();
 }
 
 // Have this be called by a timer interrupt
@@ -0,0 +1,132 @@
+// 2015 Adam Jesionowski
+
+/*
+ * A small workload for the Linux port. A producer and a consumer pass numbers through a queue that is
+ * too small to hold them all, so both sides block. A third, higher priority task wakes every 5 ticks for the
+ * whole time, starts the producer with an event, and collects the result.
+ * The process exits with 0 if everything arrived in order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "rtos.h"
+#include "port.h"
+#include "queue.h"
+#include "event.h"
+#include "task.h"
+
+#define NUM_ITEMS   10000
+#define QUEUE_SIZE  4
+#define NUM_DELAYS  20
+
+static void ProducerMain();
+static void ConsumerMain();
+static void SleeperMain();
+
+static uintd_t producerStack[DFLT_STACK_SIZE];
+static uintd_t consumerStack[DFLT_STACK_SIZE];
+static uintd_t sleeperStack[DFLT_STACK_SIZE];
+
+static Task_t producer = { PRIORITY_1, {NULL, NULL, &producer}, 0, NULL };
+static Task_t consumer = { PRIORITY_2, {NULL, NULL, &consumer}, 0, NULL };
+static Task_t sleeper  = { PRIORITY_3, {NULL, NULL, &sleeper},  0, NULL };
+
+static Queue_t  queue;
+static uint32_t queueStorage[QUEUE_SIZE];
+static Queue_t  doneQueue;
+static uint32_t doneStorage[1];
+static Event_t  startEvent;
+static Event_t  neverEvent;
+
+static void ProducerMain()
+{
+    uint32_t i;
+
+    // Wait until the sleeper says to go
+    WaitForEvent(&startEvent);
+
+    for(i = 0; i < NUM_ITEMS; i++)
+    {
+        EnqueueBlocking(&queue, (uint8_t*)&i);
+    }
+
+    WaitForEvent(&neverEvent);
+}
+
+static void ConsumerMain()
+{
+    uint32_t i;
+    uint32_t value;
+
+    for(i = 0; i < NUM_ITEMS; i++)
+    {
+        DequeueBlocking(&queue, (uint8_t*)&value);
+
+        if(value != i)
+        {
+            break;
+        }
+    }
+
+    // Report how many arrived in order
+    EnqueueBlocking(&doneQueue, (uint8_t*)&i);
+
+    WaitForEvent(&neverEvent);
+}
+
+static void SleeperMain()
+{
+    uint32_t i;
+    uint32_t received;
+    uint32_t overruns = 0;
+    uint64_t start    = GetTickCount64();
+    uint64_t lastWake = start;
+
+    for(i = 0; i < NUM_DELAYS; i++)
+    {
+        if(DelayUntil(&lastWake, 5))
+        {
+            overruns++;
+        }
+
+        if(i == 0)
+        {
+            TriggerEvent(&startEvent);
+        }
+    }
+
+    DequeueBlocking(&doneQueue, (uint8_t*)&received);
+
+    ENTER_CRITICAL_SECTION;
+    printf("%s: %u of %u items passed through a %u element queue in order, %u periods took %u ticks (%u overrun)\n",
+           (received == NUM_ITEMS) ? "OK" : "FAIL", received, NUM_ITEMS, QUEUE_SIZE, NUM_DELAYS,
+           (unsigned)(GetTickCount64() - start), overruns);
+    exit((received == NUM_ITEMS) ? 0 : 1);
+}
+
+int main(int ac, char** av)
+{
+    RTOS_Initialize();
+
+    InitQueue(&queue, (uint8_t*)queueStorage, sizeof(uint32_t), QUEUE_SIZE);
+    InitQueue(&doneQueue, (uint8_t*)doneStorage, sizeof(uint32_t), 1);
+    InitEvent(&startEvent);
+    InitEvent(&neverEvent);
+
+    producer.stackPtr = InitStack(&producerStack[DFLT_STACK_SIZE-1], ProducerMain);
+    consumer.stackPtr = InitStack(&consumerStack[DFLT_STACK_SIZE-1], ConsumerMain);
+    sleeper.stackPtr  = InitStack(&sleeperStack[DFLT_STACK_SIZE-1], SleeperMain);
+
+    StartTask(&producer);
+    StartTask(&consumer);
+    StartTask(&sleeper);
+
+    InitSoftwareInterrupt();
+    InitHardwareTimer();
+    InitTickTimer();
+
+    StartFirstTask();
+
+    return 1;
+}
@@ -0,0 +1,96 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Configuration for running the RTOS as a process on a Linux host, see port/Linux/port.c.
+ */
+
+#ifndef CONFIG_H
+#define	CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Interrupts are signals on this port. Critical sections block them, and nest.
+#define SWITCH_TO_NEXT_INT ReleaseControl()
+
+#define ENTER_CRITICAL_SECTION PortEnterCritical()
+#define EXIT_CRITICAL_SECTION  PortExitCritical()
+
+void ReleaseControl();
+void PortEnterCritical();
+void PortExitCritical();
+
+#ifndef	NULL
+    #define NULL (0)
+#endif	/* NULL */
+
+// Default size type (should be equal to width of processor)
+typedef uint64_t uintd_t;
+
+// Priority
+#define NUM_PRIORITY_LEVELS 7
+#define PRIORITY_0 0
+#define PRIORITY_1 1
+#define PRIORITY_2 2
+#define PRIORITY_3 3
+#define PRIORITY_4 4
+#define PRIORITY_5 5
+#define PRIORITY_6 6
+
+#define PRIORITY_IDLE PRIORITY_0
+
+// Count leading zeros of a non-zero uintd_t. The scheduler uses this to find the highest ready priority,
+// so it should map to a single instruction where the processor has one (e.g. clz on MIPS32).
+#define COUNT_LEADING_ZEROS(x) ((uintd_t)__builtin_clzll(x))
+
+// Atomic accesses for the lock free ring buffer. Loads that acquire and stores that release are enough to pass
+// elements between one producer and one consumer, the fence orders a store before a following load.
+#define ATOMIC_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FENCE()              __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Compare and swap for semaphores: if *p equals *e, store d and return true. Otherwise copy *p to *e and return false.
+#define ATOMIC_COMPARE_EXCHANGE(p, e, d) __atomic_compare_exchange_n((p), (e), (d), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+// Stack
+// InitStack assumes every task stack is DFLT_STACK_SIZE long, and signal handlers run on
+// task stacks, so these are much larger than on a microcontroller.
+#define DFLT_STACK_SIZE	16384
+#define OS_STACK_SIZE	800
+
+// The hardware timer counts microseconds of CLOCK_MONOTONIC
+typedef uintd_t TIME;
+#define TIMER_MAX  18446744073709551615ULL // 64-bit uint max
+
+TIME PortReadTimerRegister();
+#define READ_TIMER_REGISTER() PortReadTimerRegister()
+
+// Number of hardware timer counts in one tick, the tick signal fires this often
+#define TIMER_COUNTS_PER_TICK 1000
+
+// Define this to stop the tick while only the idle task can run. The port must implement PortSuppressTicks.
+#define TICKLESS_IDLE
+
+// Don't bother suppressing the tick unless at least this many ticks can be skipped
+#define TICKLESS_MIN_IDLE_TICKS 2
+
+// Define this to call software timer callbacks from a task, rather than the timer interrupt. See timerDaemon.h.
+// #define TIMER_DAEMON
+#define TIMER_DAEMON_PRIORITY   PRIORITY_5
+#define TIMER_DAEMON_QUEUE_SIZE 8
+
+#ifdef RUNTESTS
+    #define LOOP(b)
+#else
+    #define LOOP(b) while(b)
+#endif
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PORT_TYPES_H */
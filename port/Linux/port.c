@@ -0,0 +1,315 @@
+// 2015 Adam Jesionowski
+
+/*
+ * Port for running the RTOS as a single Linux process, so that real multi-task workloads
+ * can run on a host.
+ *
+ * Each task gets a ucontext_t stored at the top of its stack, and TaskStackPtr points at the current
+ * task's context. Switching tasks works as it does on the hardware ports: the kernel changes TaskStackPtr,
+ * and when the interrupt (here, the signal handler or ReleaseControl) finishes, we swap to whatever context
+ * it now points to.
+ *
+ * Interrupts are signals. SIGALRM from an interval timer drives Tick, and SIGUSR1 from a one-shot POSIX timer
+ * drives the software timers. Critical sections block both signals, and keep a nesting count for each task.
+ *
+ * As a signal can switch tasks at any point outside of a critical section, tasks should only call into libc
+ * functions that take locks (printf, malloc, ...) from inside a critical section.
+ */
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include "port.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "timer.h"
+#include "task.h"
+
+// Each task's saved state, kept at the top of its stack
+typedef struct _linux_context_t
+{
+    ucontext_t context;
+    uintd_t    criticalNesting;     // How deep in critical sections the task was when it was switched out
+    void       (*func)();           // Where the task starts
+} LinuxContext_t;
+
+extern volatile uintd_t* TaskStackPtr;
+
+static volatile uintd_t CriticalNesting;
+static sigset_t         InterruptSignals;
+static timer_t          HardwareTimer;
+
+/*
+ * Change to the context TaskStackPtr points to, if the kernel switched tasks since from was current
+ */
+static void SwitchContext(volatile uintd_t* from)
+{
+    LinuxContext_t* old  = (LinuxContext_t*)from;
+    LinuxContext_t* next = (LinuxContext_t*)TaskStackPtr;
+
+    if(old != next)
+    {
+        old->criticalNesting = CriticalNesting;
+        swapcontext(&old->context, &next->context);
+
+        // We're back, restore our own nesting
+        CriticalNesting = old->criticalNesting;
+    }
+}
+
+/*
+ * All tasks start here, with interrupts enabled and out of any critical sections
+ */
+static void TaskEntry()
+{
+    CriticalNesting = 0;
+    ((LinuxContext_t*)TaskStackPtr)->func();
+
+    // Tasks should never return
+    abort();
+}
+
+volatile uintd_t* InitStack(volatile uintd_t* StackPtr, void* func)
+{
+    LinuxContext_t* ctx;
+    uint8_t*        stackBase;
+
+    // The OS stack isn't used, interrupts run on the task's stack
+    if(func == NULL)
+    {
+        return StackPtr;
+    }
+
+    // StackPtr is the last element of the task's stack, put the context just below it
+    stackBase = (uint8_t*)(StackPtr - (DFLT_STACK_SIZE - 1));
+    ctx = (LinuxContext_t*)(((uintptr_t)StackPtr - sizeof(LinuxContext_t)) & ~(uintptr_t)15);
+
+    getcontext(&ctx->context);
+    ctx->context.uc_stack.ss_sp   = stackBase;
+    ctx->context.uc_stack.ss_size = (uint8_t*)ctx - stackBase;
+    ctx->context.uc_link          = NULL;
+    sigemptyset(&ctx->context.uc_sigmask);
+    makecontext(&ctx->context, TaskEntry, 0);
+
+    ctx->criticalNesting = 0;
+    ctx->func            = (void (*)())func;
+
+    return (volatile uintd_t*)ctx;
+}
+
+void PortEnterCritical()
+{
+    if(CriticalNesting == 0)
+    {
+        sigprocmask(SIG_BLOCK, &InterruptSignals, NULL);
+    }
+
+    CriticalNesting++;
+}
+
+void PortExitCritical()
+{
+    CriticalNesting--;
+
+    // Any interrupt that came in while we were in the critical section will be handled here
+    if(CriticalNesting == 0)
+    {
+        sigprocmask(SIG_UNBLOCK, &InterruptSignals, NULL);
+    }
+}
+
+/*
+ * Equivalent of the software interrupt, switches to the next task right away
+ */
+void ReleaseControl()
+{
+    volatile uintd_t* from = TaskStackPtr;
+
+    PortEnterCritical();
+
+    SwitchToNextAvailableTask();
+    SwitchContext(from);
+
+    PortExitCritical();
+}
+
+// The tick interrupt
+static void TickSignalHandler(int sig)
+{
+    volatile uintd_t* from = TaskStackPtr;
+
+    // The signal is blocked while we're handling it, so treat the handler as a critical section
+    CriticalNesting++;
+
+    Tick();
+    SwitchContext(from);
+
+    CriticalNesting--;
+}
+
+// The hardware timer interrupt
+static void HardwareTimerSignalHandler(int sig)
+{
+    volatile uintd_t* from = TaskStackPtr;
+
+    CriticalNesting++;
+
+    TimerInterrupt();
+
+    // A timer callback may have readied a more important task
+    SwitchToHighestPriorityTaskFromISR();
+    SwitchContext(from);
+
+    CriticalNesting--;
+}
+
+static void InstallHandler(int sig, void (*handler)(int))
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    action.sa_mask    = InterruptSignals;   // Interrupts don't nest
+    action.sa_flags   = SA_RESTART;
+
+    sigaction(sig, &action, NULL);
+}
+
+static void InitInterruptSignals()
+{
+    sigemptyset(&InterruptSignals);
+    sigaddset(&InterruptSignals, SIGALRM);
+    sigaddset(&InterruptSignals, SIGUSR1);
+}
+
+/*
+ * Start the tick timer with the first tick after the passed number of microseconds
+ */
+static void StartTick(uintd_t firstTickUs)
+{
+    struct itimerval tick;
+
+    tick.it_value.tv_sec     = firstTickUs / 1000000;
+    tick.it_value.tv_usec    = firstTickUs % 1000000;
+    tick.it_interval.tv_sec  = TIMER_COUNTS_PER_TICK / 1000000;
+    tick.it_interval.tv_usec = TIMER_COUNTS_PER_TICK % 1000000;
+
+    setitimer(ITIMER_REAL, &tick, NULL);
+}
+
+void InitTickTimer()
+{
+    InitInterruptSignals();
+    InstallHandler(SIGALRM, TickSignalHandler);
+    StartTick(TIMER_COUNTS_PER_TICK);
+}
+
+void InitSoftwareInterrupt()
+{
+    // ReleaseControl switches tasks directly, there's no interrupt to set up
+}
+
+void InitHardwareTimer()
+{
+    struct sigevent event;
+
+    InitInterruptSignals();
+    InstallHandler(SIGUSR1, HardwareTimerSignalHandler);
+
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo  = SIGUSR1;
+
+    timer_create(CLOCK_MONOTONIC, &event, &HardwareTimer);
+}
+
+/*
+ * The hardware timer register counts microseconds
+ */
+TIME PortReadTimerRegister()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (TIME)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void PortStartHardwareTimer(TIME time)
+{
+    struct itimerspec expire;
+
+    // A zero value would disarm the timer rather than fire it straight away
+    if(time == 0)
+    {
+        time = 1;
+    }
+
+    memset(&expire, 0, sizeof(expire));
+    expire.it_value.tv_sec  = time / 1000000;
+    expire.it_value.tv_nsec = (time % 1000000) * 1000;
+
+    timer_settime(HardwareTimer, 0, &expire, NULL);
+}
+
+/*
+ * Called by the idle task inside a critical section. The tick is stopped, then we wait with the interrupt
+ * signals still blocked until one arrives or the time is up. A signal that woke us is raised again so
+ * that its handler runs once the critical section ends.
+ */
+uintd_t PortSuppressTicks(uintd_t ticks)
+{
+    static const struct itimerval stopped;
+    struct timespec timeout;
+    siginfo_t info;
+    TIME start;
+    TIME elapsedUs;
+    uintd_t elapsed;
+    int sig;
+
+    // Keep the sleep to something timespec can hold comfortably
+    if(ticks > 1000000000 / TIMER_COUNTS_PER_TICK)
+    {
+        ticks = 1000000000 / TIMER_COUNTS_PER_TICK;
+    }
+
+    setitimer(ITIMER_REAL, &stopped, NULL);
+    start = PortReadTimerRegister();
+
+    timeout.tv_sec  = (ticks * TIMER_COUNTS_PER_TICK) / 1000000;
+    timeout.tv_nsec = ((ticks * TIMER_COUNTS_PER_TICK) % 1000000) * 1000;
+
+    sig = sigtimedwait(&InterruptSignals, &info, &timeout);
+
+    elapsedUs = PortReadTimerRegister() - start;
+    elapsed   = elapsedUs / TIMER_COUNTS_PER_TICK;
+
+    if(elapsed > ticks)
+    {
+        elapsed = ticks;
+    }
+
+    if(sig > 0)
+    {
+        raise(sig);
+    }
+
+    // Restart the tick, keeping the partial tick we were part way through
+    StartTick(TIMER_COUNTS_PER_TICK - (elapsedUs % TIMER_COUNTS_PER_TICK));
+
+    return elapsed;
+}
+
+/*
+ * Begin running tasks, starting with the idle task. This does not return.
+ */
+void StartFirstTask()
+{
+    CriticalNesting = 0;
+    setcontext(&((LinuxContext_t*)TaskStackPtr)->context);
+}
@@ -31,11 +31,49 @@ volatile uint32_t* InitStack(volatile uint32_t* StackPtr, void* func)
     return StackPtr;
 }
 
+// Timer1 counts in one tick, and the most ticks its 16 bit period register can stretch over
+#define TICK_PERIOD             2500
+#define MAX_SUPPRESSED_TICKS    (0xFFFF / TICK_PERIOD)
+
 // Configure RTOS timer interrupt
 void InitTickTimer()
 {
     ConfigIntTimer1(T1_INT_ON | T1_INT_PRIOR_1 | T1_INT_SUB_PRIOR_0);
-    OpenTimer1(T1_ON | T1_IDLE_CON | T1_PS_1_8, 2500); // 1 mS
+    OpenTimer1(T1_ON | T1_IDLE_CON | T1_PS_1_8, TICK_PERIOD); // 1 mS
+}
+
+// Called by the idle task with interrupts disabled. The tick period is stretched to cover the idle time,
+// then we wait for an interrupt. The M4K core leaves wait on a pending interrupt even with interrupts
+// disabled, so the ISR only runs once we're done here.
+uintd_t PortSuppressTicks(uintd_t ticks)
+{
+    uintd_t elapsed;
+
+    if(ticks > MAX_SUPPRESSED_TICKS)
+    {
+        ticks = MAX_SUPPRESSED_TICKS;
+    }
+
+    // Timer1 keeps counting from where the current tick is, so no time is lost
+    PR1 = ticks * TICK_PERIOD;
+
+    asm volatile("wait");
+
+    if(INTGetFlag(INT_T1))
+    {
+        // The stretched tick expired. Its pending interrupt will call Tick for the last tick, so don't count that one.
+        elapsed = ticks - 1;
+    }
+    else
+    {
+        // Something else woke us up. Count the whole ticks that passed and carry the remainder into the next tick.
+        elapsed = TMR1 / TICK_PERIOD;
+        TMR1 = TMR1 % TICK_PERIOD;
+    }
+
+    PR1 = TICK_PERIOD;
+
+    return elapsed;
 }
 
 // Occurs every second
@@ -106,5 +144,8 @@ void CoreTimerInterrupt()
     INTClearFlag(INT_CT);
 
     TimerInterrupt();
+
+    // A timer callback, or a callback posted to the timer daemon, may have readied a more important task
+    SwitchToHighestPriorityTaskFromISR();
 }
 
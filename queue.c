@@ -1,9 +1,107 @@
 // 2015 Adam Jesionowski
 
+#include <string.h>
 #include "config.h"
 #include "queue.h"
 #include "rtos.h"
 #include "port.h"
+#include "queueSet.h"
+
+/*
+ * Element copy functions. The fixed size copies let the compiler emit a single load and store for each,
+ * whatever the alignment of the caller's buffer.
+ */
+static void Copy1(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    *dest = *src;
+}
+
+static void Copy2(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    memcpy(dest, src, 2);
+}
+
+static void Copy4(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    memcpy(dest, src, 4);
+}
+
+static void Copy8(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    memcpy(dest, src, 8);
+}
+
+static void CopyMemcpy(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    memcpy(dest, src, size);
+}
+
+/*
+ * Only used for queues whose element size is a whole number of words. Each word is copied with a fixed size
+ * memcpy, which the compiler turns into a single load and store, whatever the alignment of the caller's buffer.
+ */
+static void CopyWords(uint8_t* dest, uint8_t* src, uintd_t size)
+{
+    uintd_t i;
+
+    for(i = 0; i < size; i += sizeof(uintd_t))
+    {
+        memcpy(dest + i, src + i, sizeof(uintd_t));
+    }
+}
+
+/*
+ * Pick the fastest way to copy elements of sizeOf bytes in and out of storage at start
+ */
+static QueueCopy_t SelectCopy(uint8_t* start, uintd_t sizeOf)
+{
+    switch(sizeOf)
+    {
+        case 1: return Copy1;
+        case 2: return Copy2;
+        case 4: return Copy4;
+        case 8: return Copy8;
+        default: break;
+    }
+
+    if((sizeOf % sizeof(uintd_t)) == 0 && ((uintptr_t)start % sizeof(uintd_t)) == 0)
+    {
+        return CopyWords;
+    }
+
+    return CopyMemcpy;
+}
+
+static bool IsPowerOfTwo(uintd_t x)
+{
+    return (x != 0) && ((x & (x - 1)) == 0);
+}
+
+/*
+ * Wrap an element position around the end of the queue
+ */
+static uintd_t WrapPosition(Queue_t* queue, uintd_t pos)
+{
+    if(queue->pow2Size)
+    {
+        return pos & queue->mask;
+    }
+
+    return pos % queue->maxSize;
+}
+
+/*
+ * Returns a pointer to the element at pos in the queue's storage
+ */
+static uint8_t* ElementAt(Queue_t* queue, uintd_t pos)
+{
+    if(queue->pow2SizeOf)
+    {
+        return queue->start + (pos << queue->shift);
+    }
+
+    return queue->start + (pos * queue->sizeOf);
+}
 
 /*
  * Initialize the queue struct
@@ -15,8 +113,24 @@ void InitQueue(Queue_t* queue, uint8_t* start, uintd_t sizeOf, uintd_t maxSize)
     queue->count   = 0;
     queue->maxSize = maxSize;
     queue->sizeOf  = sizeOf;
-    queue->tasksBlockedOnRead  = NULL;
-    queue->tasksBlockedOnWrite = NULL;
+    queue->copy    = SelectCopy(start, sizeOf);
+
+    queue->pow2Size   = IsPowerOfTwo(maxSize);
+    queue->pow2SizeOf = IsPowerOfTwo(sizeOf);
+    queue->mask       = maxSize - 1;
+    queue->shift      = 0;
+
+    while(queue->pow2SizeOf && ((uintd_t)1 << queue->shift) < sizeOf)
+    {
+        queue->shift++;
+    }
+
+    queue->reserved = false;
+    queue->acquired = false;
+    queue->set      = NULL;
+
+    InitList(&queue->tasksBlockedOnRead);
+    InitList(&queue->tasksBlockedOnWrite);
 }
 
 /*
@@ -24,62 +138,149 @@ void InitQueue(Queue_t* queue, uint8_t* start, uintd_t sizeOf, uintd_t maxSize)
  *
  * Checking whether data is available/queue is not full is done by the blocking/non-blocking
  * functions that call these functions.
+ *
+ * Only the highest priority task waiting on the queue is woken, and it is handed its data directly, so it
+ * never has to retry once it runs again. A task blocked on a queue has its waitData pointing at the buffer it
+ * passed in, and the operation that completes its request sets waitData back to NULL.
+ *
+ * Tasks blocked in QueueReserveBlocking, QueuePeekAcquireBlocking or the batch functions have no single buffer,
+ * so their waitData is NULL. They are just readied once there is space or data, and try again when they run.
  */
 
 /*
- * Add an element to the queue
+ * Whether a new element can go in. While an element is reserved, the slot at the tail belongs to the reserving task.
  */
-static void EnqueueOp(Queue_t* queue, uint8_t* src)
+static bool CanWrite(Queue_t* queue)
 {
-    uintd_t   i;
-    uintd_t   pos;
-    uint8_t*  tail;
+    return !queue->reserved && (queue->count < queue->maxSize);
+}
 
-    // pos represents where we are in the queue in terms of element count
-    pos  = (queue->front + queue->count) % queue->maxSize;
+/*
+ * Whether an element can be taken. While the front element is acquired, nothing else may be removed.
+ */
+static bool CanRead(Queue_t* queue)
+{
+    return !queue->acquired && (queue->count != 0);
+}
 
-    // tail is a pointer to where we are in the queue in terms of raw bytes
-    tail = queue->start + (pos * queue->sizeOf);
+/*
+ * Returns a pointer to the slot after the last element
+ */
+static uint8_t* Tail(Queue_t* queue)
+{
+    return ElementAt(queue, WrapPosition(queue, queue->front + queue->count));
+}
 
-    // Copy the data from src into the queue
-    for(i = 0; i < queue->sizeOf; i++)
+/*
+ * Tell the queue's set, if it's in one, that n elements were added
+ */
+static void PostToSet(Queue_t* queue, uintd_t n)
+{
+    if(queue->set != NULL)
     {
-        tail[i] = src[i];
+        QueueSetPost(queue->set, queue, n);
     }
+}
+
+/*
+ * Copy one element into the end of the queue's storage
+ */
+static void CopyToTail(Queue_t* queue, uint8_t* src)
+{
+    queue->copy(Tail(queue), src, queue->sizeOf);
 
     // Increment the item count
     queue->count++;
 
-    // If we have any tasks waiting for data to be added, unblock them.
-    if(queue->tasksBlockedOnRead != NULL)
+    PostToSet(queue, 1);
+}
+
+/*
+ * Copy the front element out of the queue's storage and remove it
+ */
+static void CopyFromFront(Queue_t* queue, uint8_t* dest)
+{
+    queue->copy(dest, ElementAt(queue, queue->front), queue->sizeOf);
+
+    queue->count--;
+    queue->front = WrapPosition(queue, queue->front + 1);
+}
+
+/*
+ * Hand elements to the tasks waiting to dequeue, highest priority first, for as long as there are elements.
+ * A task waiting to acquire is readied to take the element itself, and as it will then hold the queue's front,
+ * no more tasks are woken after it.
+ */
+static void WakeReaders(Queue_t* queue)
+{
+    while(CanRead(queue) && queue->tasksBlockedOnRead.head != NULL)
     {
-        ReadyTaskEntireList(&queue->tasksBlockedOnRead);
+        Task_t* task = ReadyHighestPriorityTask(&queue->tasksBlockedOnRead);
+
+        if(task->waitData == NULL)
+        {
+            break;
+        }
+
+        CopyFromFront(queue, task->waitData);
+        task->waitData = NULL;
     }
 }
 
 /*
- * Remove an element from the queue, copying it to dest
+ * Move elements from the tasks waiting to enqueue into free space, highest priority first. As with WakeReaders,
+ * a task waiting to reserve is readied to take the space itself.
  */
-static void DequeueOp(Queue_t* queue, uint8_t* dest)
+static void WakeWriters(Queue_t* queue)
 {
-    uintd_t i;
-    uint8_t* head;
+    while(CanWrite(queue) && queue->tasksBlockedOnWrite.head != NULL)
+    {
+        Task_t* task = ReadyHighestPriorityTask(&queue->tasksBlockedOnWrite);
 
-    head = queue->start + (queue->front * queue->sizeOf);
+        if(task->waitData == NULL)
+        {
+            break;
+        }
 
-    for(i = 0; i < queue->sizeOf; i++)
-    {
-        dest[i] = head[i];
+        CopyToTail(queue, task->waitData);
+        task->waitData = NULL;
     }
-    queue->count--;
-    queue->front = (queue->front + 1) % queue->maxSize;
+}
+
+/*
+ * Add an element to the queue
+ */
+static void EnqueueOp(Queue_t* queue, uint8_t* src)
+{
+    List_t* reader = queue->tasksBlockedOnRead.head;
 
-    if(queue->tasksBlockedOnWrite != NULL)
+    // A task can only be waiting for data with an empty queue. Unless it's waiting to acquire the element in
+    // place, give the element straight to it rather than storing it.
+    if(queue->count == 0 && reader != NULL && ((Task_t*)reader->owner)->waitData != NULL)
     {
-        ReadyTaskEntireList(&queue->tasksBlockedOnWrite);
+        Task_t* task = ReadyHighestPriorityTask(&queue->tasksBlockedOnRead);
+
+        queue->copy(task->waitData, src, queue->sizeOf);
+        task->waitData = NULL;
+    }
+    else
+    {
+        CopyToTail(queue, src);
+        WakeReaders(queue);
     }
 }
 
+/*
+ * Remove an element from the queue, copying it to dest
+ */
+static void DequeueOp(Queue_t* queue, uint8_t* dest)
+{
+    CopyFromFront(queue, dest);
+
+    // The space we just freed goes to the highest priority task waiting to enqueue
+    WakeWriters(queue);
+}
+
 /*
  * Non-blocking Enqueue operation. If there is room in the queue, add the new element.
  * Otherwise, return false.
@@ -91,7 +292,7 @@ bool Enqueue(Queue_t* queue, uint8_t* src)
     ENTER_CRITICAL_SECTION;
 
     // Only do this if the count is less than the size of the queue
-    if(queue->count < queue->maxSize)
+    if(CanWrite(queue))
     {
         EnqueueOp(queue, src);
         error = false;
@@ -113,7 +314,7 @@ bool Dequeue(Queue_t* queue, uint8_t* dest)
     ENTER_CRITICAL_SECTION;
 
     // Only do this if there is any data
-    if(queue->count != 0)
+    if(CanRead(queue))
     {
         DequeueOp(queue, dest);
         error = false;
@@ -130,60 +331,442 @@ bool Dequeue(Queue_t* queue, uint8_t* dest)
  */
 void EnqueueBlocking(Queue_t* queue, uint8_t* src)
 {
-    bool wait = true;
+    ENTER_CRITICAL_SECTION;
+
+    if(CanWrite(queue))
+    {
+        EnqueueOp(queue, src);
+    }
+    else
+    {
+        // Wait for a dequeue to move our element into the space it frees. This is done before leaving the
+        // critical section, otherwise space could free up (and nobody would unblock us) before we're on the
+        // blocked list. By the time we run again the element has been added.
+        GetCurrentTask()->waitData = src;
+        BlockCurrentTaskToList(&queue->tasksBlockedOnWrite);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Blocking Dequeue operation. If there is no data in the queue, the task calling this function will block
+ * until there is.
+ */
+void DequeueBlocking(Queue_t* queue, uint8_t* dest)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(CanRead(queue))
+    {
+        DequeueOp(queue, dest);
+    }
+    else
+    {
+        // The next enqueue copies its element straight into dest
+        GetCurrentTask()->waitData = dest;
+        BlockCurrentTaskToList(&queue->tasksBlockedOnRead);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Blocking Enqueue operation with a timeout. If there is no room in the queue, the task calling this function
+ * will block until there is, or the passed number of ticks pass. Returns true if it timed out without adding
+ * the element.
+ */
+bool EnqueueBlockingTimeout(Queue_t* queue, uint8_t* src, uintd_t ticks)
+{
+    bool    timedOut = false;
+    bool    blocked  = false;
+    Task_t* self = GetCurrentTask();
+
+    ENTER_CRITICAL_SECTION;
+
+    if(CanWrite(queue))
+    {
+        EnqueueOp(queue, src);
+    }
+    else if(ticks == 0)
+    {
+        timedOut = true;
+    }
+    else
+    {
+        self->waitData = src;
+        BlockCurrentTaskToListTimeout(&queue->tasksBlockedOnWrite, ticks);
+        blocked = true;
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    // The switch away happens once we leave the critical section. By the time we get here again,
+    // either the operation was done for us or we ran out of time.
+    if(blocked)
+    {
+        timedOut = self->timedOut;
+    }
+
+    return timedOut;
+}
+
+/*
+ * Blocking Dequeue operation with a timeout. If there is no data in the queue, the task calling this function
+ * will block until there is, or the passed number of ticks pass. Returns true if it timed out without
+ * removing an element.
+ */
+bool DequeueBlockingTimeout(Queue_t* queue, uint8_t* dest, uintd_t ticks)
+{
+    bool    timedOut = false;
+    bool    blocked  = false;
+    Task_t* self = GetCurrentTask();
+
+    ENTER_CRITICAL_SECTION;
+
+    if(CanRead(queue))
+    {
+        DequeueOp(queue, dest);
+    }
+    else if(ticks == 0)
+    {
+        timedOut = true;
+    }
+    else
+    {
+        self->waitData = dest;
+        BlockCurrentTaskToListTimeout(&queue->tasksBlockedOnRead, ticks);
+        blocked = true;
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    // The switch away happens once we leave the critical section. By the time we get here again,
+    // either the operation was done for us or we ran out of time.
+    if(blocked)
+    {
+        timedOut = self->timedOut;
+    }
+
+    return timedOut;
+}
+
+/*
+ * Copy count elements between src and dest, where the queue's storage is on the side that starts at element pos.
+ * toQueue says which way we're copying. Elements past the end of the storage wrap to the start, so this takes at
+ * most two copies.
+ */
+static void CopyRun(Queue_t* queue, uintd_t pos, uint8_t* buffer, uintd_t count, bool toQueue)
+{
+    uintd_t first = queue->maxSize - pos;
+    uint8_t* ring = ElementAt(queue, pos);
+
+    if(first > count)
+    {
+        first = count;
+    }
+
+    if(toQueue)
+    {
+        memcpy(ring, buffer, first * queue->sizeOf);
+        memcpy(queue->start, buffer + (first * queue->sizeOf), (count - first) * queue->sizeOf);
+    }
+    else
+    {
+        memcpy(buffer, ring, first * queue->sizeOf);
+        memcpy(buffer + (first * queue->sizeOf), queue->start, (count - first) * queue->sizeOf);
+    }
+}
+
+/*
+ * Add as many of the n elements at src as there's room for, returning how many were added.
+ * Waiting tasks are woken once for the whole batch.
+ */
+static uintd_t EnqueueManyOp(Queue_t* queue, uint8_t* src, uintd_t n)
+{
+    uintd_t space = CanWrite(queue) ? (queue->maxSize - queue->count) : 0;
+
+    if(n > space)
+    {
+        n = space;
+    }
+
+    if(n != 0)
+    {
+        CopyRun(queue, WrapPosition(queue, queue->front + queue->count), src, n, true);
+        queue->count += n;
+
+        PostToSet(queue, n);
+        WakeReaders(queue);
+
+        // A writer that was readied to retry may have left space behind it for others
+        WakeWriters(queue);
+    }
+
+    return n;
+}
+
+/*
+ * Remove up to n elements into dest, returning how many were removed.
+ * Waiting tasks are woken once for the whole batch.
+ */
+static uintd_t DequeueManyOp(Queue_t* queue, uint8_t* dest, uintd_t n)
+{
+    uintd_t available = CanRead(queue) ? queue->count : 0;
+
+    if(n > available)
+    {
+        n = available;
+    }
+
+    if(n != 0)
+    {
+        CopyRun(queue, queue->front, dest, n, false);
+        queue->count -= n;
+        queue->front  = WrapPosition(queue, queue->front + n);
+
+        WakeWriters(queue);
+        WakeReaders(queue);
+    }
+
+    return n;
+}
+
+/*
+ * Non-blocking batch Enqueue. Adds as many of the n elements at src as there is room for, in one critical section,
+ * and returns how many were added.
+ */
+uintd_t EnqueueMany(Queue_t* queue, uint8_t* src, uintd_t n)
+{
+    ENTER_CRITICAL_SECTION;
+
+    n = EnqueueManyOp(queue, src, n);
+
+    EXIT_CRITICAL_SECTION;
+
+    return n;
+}
+
+/*
+ * Non-blocking batch Dequeue. Removes up to n elements into dest in one critical section,
+ * and returns how many were removed.
+ */
+uintd_t DequeueMany(Queue_t* queue, uint8_t* dest, uintd_t n)
+{
+    ENTER_CRITICAL_SECTION;
+
+    n = DequeueManyOp(queue, dest, n);
+
+    EXIT_CRITICAL_SECTION;
+
+    return n;
+}
+
+/*
+ * Blocking batch Enqueue. Adds up to n elements from src, blocking until at least min of them have been added.
+ * Returns how many were added.
+ */
+uintd_t EnqueueManyBlocking(Queue_t* queue, uint8_t* src, uintd_t n, uintd_t min)
+{
+    uintd_t done = 0;
+    bool    wait = true;
 
-    // In order to test this function, LOOP is used as a define in config.h
-    // For running on the target hardware, LOOP(x) is defined as while(x).
-    // On a host computer, it's defined as "", allowing us to test this function, as otherwise
-    // it would sit in a loop, unable to return.
     LOOP(wait)
     {
         ENTER_CRITICAL_SECTION;
 
-        if(queue->count < queue->maxSize)
+        done += EnqueueManyOp(queue, src + (done * queue->sizeOf), n - done);
+
+        wait = (done < min);
+
+        if(wait)
         {
-            wait = false;
-            EnqueueOp(queue, src);
+            // We're readied whenever space frees up, then add what we can and wait again if need be
+            GetCurrentTask()->waitData = NULL;
+            BlockCurrentTaskToList(&queue->tasksBlockedOnWrite);
         }
 
         EXIT_CRITICAL_SECTION;
+    }
+
+    return done;
+}
+
+/*
+ * Blocking batch Dequeue. Removes up to n elements into dest, blocking until at least min of them have been removed.
+ * Returns how many were removed.
+ */
+uintd_t DequeueManyBlocking(Queue_t* queue, uint8_t* dest, uintd_t n, uintd_t min)
+{
+    uintd_t done = 0;
+    bool    wait = true;
+
+    LOOP(wait)
+    {
+        ENTER_CRITICAL_SECTION;
+
+        done += DequeueManyOp(queue, dest + (done * queue->sizeOf), n - done);
+
+        wait = (done < min);
 
-        // If we didn't add data, wait until we can.
-        // Note that multiple tasks can be blocked on a single queue, and all tasks will be unblocked
-        // immediately, even if there is only one space available. If this occurs, the highest priority task will
-        // take the space, and the rest will re-block.
         if(wait)
         {
-            BlockCurrentTaskToList(&queue->tasksBlockedOnWrite);
+            GetCurrentTask()->waitData = NULL;
+            BlockCurrentTaskToList(&queue->tasksBlockedOnRead);
         }
+
+        EXIT_CRITICAL_SECTION;
     }
+
+    return done;
 }
 
 /*
- * Blocking Dequeue operation. If there is no data in the queue, the task calling this function will block
- * until there is.
+ * Reserve the next slot in the queue so it can be written in place, returning a pointer to it.
+ * Returns NULL if the queue is full, or if another element is already reserved.
+ *
+ * The element is not in the queue until QueueCommit is called. Until then, other enqueues are refused.
  */
-void DequeueBlocking(Queue_t* queue, uint8_t* dest)
+uint8_t* QueueReserve(Queue_t* queue)
 {
-    bool wait = true;
+    uint8_t* slot = NULL;
 
-    LOOP(wait)
+    ENTER_CRITICAL_SECTION;
+
+    if(CanWrite(queue))
+    {
+        queue->reserved = true;
+        slot = Tail(queue);
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return slot;
+}
+
+/*
+ * Blocking QueueReserve. If no slot can be reserved, the task calling this function will block until one can.
+ */
+uint8_t* QueueReserveBlocking(Queue_t* queue)
+{
+    uint8_t* slot = NULL;
+
+    // In order to test this function, LOOP is used as a define in config.h
+    // For running on the target hardware, LOOP(x) is defined as while(x).
+    // On a host computer, it's defined as "", allowing us to test this function, as otherwise
+    // it would sit in a loop, unable to return.
+    LOOP(slot == NULL)
     {
         ENTER_CRITICAL_SECTION;
 
-        if(queue->count != 0)
+        if(CanWrite(queue))
+        {
+            queue->reserved = true;
+            slot = Tail(queue);
+        }
+        else
         {
-            wait = false;
-            DequeueOp(queue, dest);
+            // We're readied once there's space, but another task could take it first, so try again
+            GetCurrentTask()->waitData = NULL;
+            BlockCurrentTaskToList(&queue->tasksBlockedOnWrite);
         }
 
         EXIT_CRITICAL_SECTION;
+    }
 
-        if(wait)
+    return slot;
+}
+
+/*
+ * Add the element written to the reserved slot to the queue
+ */
+void QueueCommit(Queue_t* queue)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(queue->reserved)
+    {
+        queue->reserved = false;
+        queue->count++;
+
+        PostToSet(queue, 1);
+        WakeReaders(queue);
+        WakeWriters(queue);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Acquire the front element so it can be read in place, returning a pointer to it.
+ * Returns NULL if the queue is empty, or if the front element is already acquired.
+ *
+ * The element stays in the queue until QueueRelease is called. Until then, other dequeues are refused.
+ */
+uint8_t* QueuePeekAcquire(Queue_t* queue)
+{
+    uint8_t* element = NULL;
+
+    ENTER_CRITICAL_SECTION;
+
+    if(CanRead(queue))
+    {
+        queue->acquired = true;
+        element = ElementAt(queue, queue->front);
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return element;
+}
+
+/*
+ * Blocking QueuePeekAcquire. If there is no element to acquire, the task calling this function will block until
+ * there is.
+ */
+uint8_t* QueuePeekAcquireBlocking(Queue_t* queue)
+{
+    uint8_t* element = NULL;
+
+    LOOP(element == NULL)
+    {
+        ENTER_CRITICAL_SECTION;
+
+        if(CanRead(queue))
         {
+            queue->acquired = true;
+            element = ElementAt(queue, queue->front);
+        }
+        else
+        {
+            GetCurrentTask()->waitData = NULL;
             BlockCurrentTaskToList(&queue->tasksBlockedOnRead);
         }
+
+        EXIT_CRITICAL_SECTION;
+    }
+
+    return element;
+}
+
+/*
+ * Remove the acquired element from the queue
+ */
+void QueueRelease(Queue_t* queue)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(queue->acquired)
+    {
+        queue->acquired = false;
+        queue->count--;
+        queue->front = WrapPosition(queue, queue->front + 1);
+
+        WakeWriters(queue);
+        WakeReaders(queue);
     }
+
+    EXIT_CRITICAL_SECTION;
 }
 
 bool QueueIsEmpty(Queue_t* queue)
@@ -0,0 +1,77 @@
+// 2015 Adam Jesionowski
+
+#include "queueSet.h"
+#include "rtos.h"
+#include "port.h"
+#include "task.h"
+
+/*
+ * Initialize the set, with room for size members to be waiting in it
+ */
+void InitQueueSet(QueueSet_t* set, void** storage, uintd_t size)
+{
+    InitQueue(&set->ready, (uint8_t*)storage, sizeof(void*), size);
+}
+
+/*
+ * Add a queue to the set. Any elements it already holds are added to the set as well.
+ */
+void QueueSetAddQueue(QueueSet_t* set, Queue_t* queue)
+{
+    ENTER_CRITICAL_SECTION;
+
+    queue->set = set;
+    QueueSetPost(set, queue, queue->count);
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Add an event to the set. Only triggers from now on are seen by WaitAny.
+ */
+void QueueSetAddEvent(QueueSet_t* set, Event_t* event)
+{
+    event->set = set;
+}
+
+/*
+ * Called by the member queues and events. Adds member to the set n times, readying a task waiting on the set.
+ */
+void QueueSetPost(QueueSet_t* set, void* member, uintd_t n)
+{
+    ENTER_CRITICAL_SECTION;
+
+    while(n > 0 && !Enqueue(&set->ready, (uint8_t*)&member))
+    {
+        n--;
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Wait until a member of the set is readable, and return it
+ */
+void* WaitAny(QueueSet_t* set)
+{
+    void* member = NULL;
+    bool  wait = true;
+
+    LOOP(wait)
+    {
+        ENTER_CRITICAL_SECTION;
+
+        wait = Dequeue(&set->ready, (uint8_t*)&member);
+
+        if(wait)
+        {
+            // We're readied once a member posts to the set, and take its entry when we run again
+            GetCurrentTask()->waitData = NULL;
+            BlockCurrentTaskToList(&set->ready.tasksBlockedOnRead);
+        }
+
+        EXIT_CRITICAL_SECTION;
+    }
+
+    return member;
+}
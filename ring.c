@@ -0,0 +1,144 @@
+// 2015 Adam Jesionowski
+
+#include <string.h>
+#include "config.h"
+#include "ring.h"
+#include "rtos.h"
+#include "port.h"
+
+/*
+ * Initialize the ring struct. size is the number of elements, and must be a power of two.
+ */
+bool InitRing(Ring_t* ring, uint8_t* start, uintd_t sizeOf, uintd_t size)
+{
+    bool error = true;
+
+    if(size != 0 && (size & (size - 1)) == 0)
+    {
+        ring->start           = start;
+        ring->mask            = size - 1;
+        ring->sizeOf          = sizeOf;
+        ring->head            = 0;
+        ring->tail            = 0;
+        ring->consumerWaiting = false;
+        InitList(&ring->blockedTasks);
+
+        error = false;
+    }
+
+    return error;
+}
+
+/*
+ * Ready the consumer if it's waiting for data
+ */
+static void WakeConsumer(Ring_t* ring)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(ATOMIC_LOAD_ACQUIRE(&ring->consumerWaiting))
+    {
+        ATOMIC_STORE_RELEASE(&ring->consumerWaiting, false);
+        ReadyHighestPriorityTask(&ring->blockedTasks);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Add an element to the ring. Only the producer may call this. Returns true if the ring is full.
+ */
+bool RingPut(Ring_t* ring, uint8_t* src)
+{
+    uintd_t head = ring->head;
+    uintd_t tail = ATOMIC_LOAD_ACQUIRE(&ring->tail);
+
+    if(head - tail > ring->mask)
+    {
+        return true;
+    }
+
+    memcpy(ring->start + ((head & ring->mask) * ring->sizeOf), src, ring->sizeOf);
+
+    // Publish the element, then check whether the consumer needs waking. The fence stops the consumerWaiting
+    // load being done before the store, which could miss a consumer that just found the ring empty.
+    // Our tail can't be used to tell whether the ring was empty, as the consumer may have emptied it since.
+    // consumerWaiting is only set while the ring is empty though, so it's only seen on that edge.
+    ATOMIC_STORE_RELEASE(&ring->head, head + 1);
+    ATOMIC_FENCE();
+
+    if(ATOMIC_LOAD_ACQUIRE(&ring->consumerWaiting))
+    {
+        WakeConsumer(ring);
+    }
+
+    return false;
+}
+
+/*
+ * Remove an element from the ring, copying it to dest. Only the consumer may call this.
+ * Returns true if the ring is empty.
+ */
+bool RingGet(Ring_t* ring, uint8_t* dest)
+{
+    uintd_t tail = ring->tail;
+    uintd_t head = ATOMIC_LOAD_ACQUIRE(&ring->head);
+
+    if(head == tail)
+    {
+        return true;
+    }
+
+    memcpy(dest, ring->start + ((tail & ring->mask) * ring->sizeOf), ring->sizeOf);
+
+    // Only hand the slot back to the producer once we've copied out of it
+    ATOMIC_STORE_RELEASE(&ring->tail, tail + 1);
+
+    return false;
+}
+
+/*
+ * Remove an element from the ring, blocking until there is one. Only the consumer task may call this.
+ */
+void RingGetBlocking(Ring_t* ring, uint8_t* dest)
+{
+    bool wait = true;
+
+    // In order to test this function, LOOP is used as a define in config.h
+    // For running on the target hardware, LOOP(x) is defined as while(x).
+    // On a host computer, it's defined as "", allowing us to test this function, as otherwise
+    // it would sit in a loop, unable to return.
+    LOOP(wait)
+    {
+        wait = RingGet(ring, dest);
+
+        if(wait)
+        {
+            ENTER_CRITICAL_SECTION;
+
+            ATOMIC_STORE_RELEASE(&ring->consumerWaiting, true);
+            ATOMIC_FENCE();
+
+            // Check again now the producer can see we're waiting. If an element arrived in between, the producer
+            // might not have seen consumerWaiting, so don't block.
+            if(ATOMIC_LOAD_ACQUIRE(&ring->head) == ring->tail)
+            {
+                BlockCurrentTaskToList(&ring->blockedTasks);
+            }
+            else
+            {
+                ATOMIC_STORE_RELEASE(&ring->consumerWaiting, false);
+            }
+
+            EXIT_CRITICAL_SECTION;
+        }
+    }
+}
+
+/*
+ * Returns how many elements are in the ring. This is only a snapshot if called while the other side is running.
+ */
+uintd_t RingCount(Ring_t* ring)
+{
+    return ATOMIC_LOAD_ACQUIRE(&ring->head) - ATOMIC_LOAD_ACQUIRE(&ring->tail);
+}
@@ -7,17 +7,31 @@
 #include "config.h"
 #include "idleTask.h"
 #include "port.h"
+#include "timer.h"
 
 // The following variables are mostly non-static as they're used by the testRTOS file.
 
 // Lists that the RTOS handles
-List_t* SleepingTasks;
-List_t* BlockedTasks;
-List_t* ReadyTasks[ NUM_PRIORITY_LEVELS ];
+// SleepingTasks is sorted by wake time, and each task's sleepTimer is relative to the task in front of it
+ListHead_t SleepingTasks;
+ListHead_t BlockedTasks;
+ListHead_t ReadyTasks[ NUM_PRIORITY_LEVELS ];
+
+// Bitmap of which ReadyTasks lists are non-empty, bit n of word w represents priority w * PRIORITY_WORD_BITS + n.
+// ReadyGroups has bit w set whenever ReadyPriorities[w] is non-zero, so finding the highest ready priority
+// is two count leading zeros regardless of NUM_PRIORITY_LEVELS (up to PRIORITY_WORD_BITS squared levels).
+#define PRIORITY_WORD_BITS  (sizeof(uintd_t) * 8)
+#define PRIORITY_WORDS      ((NUM_PRIORITY_LEVELS + PRIORITY_WORD_BITS - 1) / PRIORITY_WORD_BITS)
+
+uintd_t ReadyGroups;
+uintd_t ReadyPriorities[ PRIORITY_WORDS ];
 
 // Pointer to the current task
 Task_t* CurrentTask;
 
+// Number of ticks since the RTOS was initialized
+volatile uint64_t TickCount;
+
 // OS stack storage
 static uintd_t OSStack[ OS_STACK_SIZE ];
 volatile uintd_t* OSStackPtr = OSStack;
@@ -28,6 +42,87 @@ volatile uintd_t IntCount = 1;
 // Pointer to current task's stack
 volatile uintd_t* TaskStackPtr;
 
+/*
+ * Mark a priority level as having at least one ready task
+ */
+static void MarkPriorityReady(uintd_t priority)
+{
+    uintd_t word = priority / PRIORITY_WORD_BITS;
+
+    ReadyPriorities[word] |= (uintd_t)1 << (priority % PRIORITY_WORD_BITS);
+    ReadyGroups |= (uintd_t)1 << word;
+}
+
+/*
+ * Clear a priority level's ready bit, should be called once its ready list is empty
+ */
+static void MarkPriorityEmpty(uintd_t priority)
+{
+    uintd_t word = priority / PRIORITY_WORD_BITS;
+
+    ReadyPriorities[word] &= ~((uintd_t)1 << (priority % PRIORITY_WORD_BITS));
+
+    if(ReadyPriorities[word] == 0)
+    {
+        ReadyGroups &= ~((uintd_t)1 << word);
+    }
+}
+
+/*
+ * Returns the highest priority level with a ready task, or -1 if no tasks are ready
+ */
+static int32_t HighestReadyPriority()
+{
+    uintd_t word;
+
+    if(ReadyGroups == 0)
+    {
+        return -1;
+    }
+
+    word = (PRIORITY_WORD_BITS - 1) - COUNT_LEADING_ZEROS(ReadyGroups);
+
+    return (int32_t)(word * PRIORITY_WORD_BITS + (PRIORITY_WORD_BITS - 1) - COUNT_LEADING_ZEROS(ReadyPriorities[word]));
+}
+
+/*
+ * Put a task at the front of its priority's ready list
+ */
+static void AddToReadyList(Task_t* task)
+{
+    AppendToList(&ReadyTasks[task->priority], &task->taskList);
+    MarkPriorityReady(task->priority);
+    task->ready = true;
+}
+
+/*
+ * Put a task at the end of its priority's ready list, used for time-slicing
+ */
+static void AddToEndOfReadyList(Task_t* task)
+{
+    AppendToEndOfList(&ReadyTasks[task->priority], &task->taskList);
+    MarkPriorityReady(task->priority);
+    task->ready = true;
+}
+
+/*
+ * Take the task at the front of the passed priority's ready list
+ */
+static Task_t* TakeFromReadyList(uintd_t priority)
+{
+    Task_t* task = (Task_t*)ReadyTasks[priority].head->owner;
+
+    RemoveFront(&ReadyTasks[priority]);
+    task->ready = false;
+
+    if(ReadyTasks[priority].head == NULL)
+    {
+        MarkPriorityEmpty(priority);
+    }
+
+    return task;
+}
+
 /*
  * Initialize RTOS variables and set idleTask as current task
  */
@@ -38,15 +133,22 @@ void RTOS_Initialize()
     // This function occurs before interrupts are enabled
     IdleTask_init();
 
-    SleepingTasks = NULL;
-    BlockedTasks = NULL;
+    InitList(&SleepingTasks);
+    InitList(&BlockedTasks);
 
     for(i = 0; i < NUM_PRIORITY_LEVELS; i++)
     {
-        ReadyTasks[i] = NULL;
+        InitList(&ReadyTasks[i]);
     }
 
+    for(i = 0; i < PRIORITY_WORDS; i++)
+    {
+        ReadyPriorities[i] = 0;
+    }
+    ReadyGroups = 0;
+
     CurrentTask = NULL;
+    TickCount = 0;
 
 #ifdef STACK_GROWS_TOWARD_ZERO
     // If the stack grows upwards, start at the end of the array
@@ -66,7 +168,8 @@ void StartTask(Task_t* task)
 {
     ENTER_CRITICAL_SECTION;
 
-    AppendToList(&ReadyTasks[task->priority], &task->taskList);
+    task->basePriority = task->priority;
+    AddToReadyList(task);
 
     EXIT_CRITICAL_SECTION;
 }
@@ -91,14 +194,19 @@ void SuspendCurrentTask()
  */
 void Tick()
 {
-    uint8_t curPriority = 0;
-    int8_t  i; // This needs to go under 0, hence signed.
+    int32_t curPriority = 0;
+    int32_t highest;
 
     ENTER_CRITICAL_SECTION;
 
     // Update the stored task pointer to what it is now
     CurrentTask->stackPtr = TaskStackPtr;
 
+    TickCount++;
+
+    // Reading the clock keeps it extended to 64 bits while no software timers are running
+    GetClock();
+
     // Start by updating sleeping tasks
     UpdateSleeping();
 
@@ -107,27 +215,19 @@ void Tick()
     {
         curPriority = CurrentTask->priority;
     }
-    Task_t* nextTask = NULL;
 
     // Note that this will be true if there is a task with the same priority level waiting
-    for(i = NUM_PRIORITY_LEVELS - 1; i >= curPriority; i--)
-    {
-        if(ReadyTasks[i] != NULL)
-        {
-            nextTask = (Task_t*)(ReadyTasks[i])->owner;
-            break;
-        }
-    }
-    
-    if(nextTask != NULL)
+    highest = HighestReadyPriority();
+
+    if(highest >= curPriority)
     {
-        RemoveFront(&ReadyTasks[nextTask->priority]);
+        Task_t* nextTask = TakeFromReadyList(highest);
 
         // We purposefully put the recently removed task at the end of the ready list to enable time-slicing
         // Putting it at the end gives each task equal share of processing
         if(CurrentTask != NULL)
         {
-            AppendToEndOfList(&ReadyTasks[CurrentTask->priority], &CurrentTask->taskList);
+            AddToEndOfReadyList(CurrentTask);
         }
         CurrentTask = nextTask;
 
@@ -139,6 +239,81 @@ void Tick()
     EXIT_CRITICAL_SECTION;
 }
 
+/*
+ * Put a task's list element on SleepingTasks, to wake in the passed number of ticks. The element is either the task's
+ * taskList, for a plain delay, or its timeoutList, while it is also blocked on another list.
+ */
+static void InsertSleeping(Task_t* task, List_t* node, uintd_t ticks)
+{
+    // Find where this task belongs in the sleeping list. Tasks waking on the same tick
+    // keep the order they went to sleep in.
+    List_t* list = SleepingTasks.head;
+
+    while(list != NULL && ((Task_t*)list->owner)->sleepTimer <= ticks)
+    {
+        ticks -= ((Task_t*)list->owner)->sleepTimer;
+        list = list->next;
+    }
+
+    // The task we're going in front of now only needs to wait however long is left after us
+    if(list != NULL)
+    {
+        ((Task_t*)list->owner)->sleepTimer -= ticks;
+    }
+
+    task->sleepTimer = ticks;
+    InsertBeforeInList(&SleepingTasks, list, node);
+}
+
+/*
+ * Take a task's element off SleepingTasks before its time is up. The task behind it now has to wait
+ * for our time as well as its own.
+ */
+static void RemoveSleeping(Task_t* task, List_t* node)
+{
+    if(node->next != NULL)
+    {
+        ((Task_t*)node->next->owner)->sleepTimer += task->sleepTimer;
+    }
+
+    RemoveFromList(&SleepingTasks, node);
+}
+
+/*
+ * Ready the task at the front of SleepingTasks. If it was blocked with a timeout, that has run out,
+ * so it's also taken off the list it was blocked on.
+ */
+static void WakeFrontSleepingTask()
+{
+    Task_t* task = (Task_t*)SleepingTasks.head->owner;
+
+    RemoveFront(&SleepingTasks);
+
+    if(task->timeoutRunning)
+    {
+        RemoveFromList(task->blockedOn, &task->taskList);
+        task->blockedOn      = NULL;
+        task->timeoutRunning = false;
+        task->timedOut       = true;
+    }
+
+    AddToReadyList(task);
+}
+
+/*
+ * Called when a task is readied from a list it was blocked on, stops its timeout if it had one
+ */
+static void CancelTimeout(Task_t* task)
+{
+    if(task->timeoutRunning)
+    {
+        RemoveSleeping(task, &task->timeoutList);
+        task->timeoutRunning = false;
+    }
+
+    task->blockedOn = NULL;
+}
+
 /*
  * This will cause the current task to sleep for the passed number of millisecond ticks.
  *
@@ -154,9 +329,7 @@ void DelayCurrentTask(uintd_t ticks)
     {
     	ENTER_CRITICAL_SECTION;
 
-    	// Set the sleep timer and add it to the sleeping tasks list
-        CurrentTask->sleepTimer = ticks;
-        AppendToList(&SleepingTasks, &CurrentTask->taskList);
+        InsertSleeping(CurrentTask, &CurrentTask->taskList, ticks);
 
         SWITCH_TO_NEXT_INT; // Interrupts and calls SwitchToNextAvailableTask() from the OS stack
 
@@ -164,17 +337,130 @@ void DelayCurrentTask(uintd_t ticks)
     }
 }
 
+/*
+ * Sleep the current task until the tick that brings GetTickCount64 to wakeTick. Returns true, without sleeping,
+ * if that tick has already happened.
+ */
+bool DelayCurrentTaskUntil(uint64_t wakeTick)
+{
+    bool passed = true;
+    bool wait   = true;
+
+    if(CurrentTask != NULL)
+    {
+        LOOP(wait)
+        {
+            ENTER_CRITICAL_SECTION;
+
+            wait = (wakeTick > TickCount);
+
+            if(wait)
+            {
+                // A task put to sleep for n ticks wakes on the n+1th tick after this one.
+                // Anything longer than a delay can be is slept in pieces.
+                uint64_t ticks = wakeTick - TickCount - 1;
+
+                if(ticks >= MAX_DELAY_TICKS)
+                {
+                    ticks = MAX_DELAY_TICKS - 1;
+                }
+
+                passed = false;
+                InsertSleeping(CurrentTask, &CurrentTask->taskList, (uintd_t)ticks);
+
+                SWITCH_TO_NEXT_INT;
+            }
+
+            EXIT_CRITICAL_SECTION;
+        }
+    }
+
+    return passed;
+}
+
+/*
+ * For tasks that run once every period ticks. lastWake holds the tick the task was last due to wake on, and
+ * should start out as GetTickCount64(). Each call moves it on by exactly period and sleeps until then, so time
+ * spent working between calls doesn't push later wake ups back.
+ *
+ * Returns true if the task overran, and the tick it was due to wake on has already passed. It doesn't sleep
+ * in that case, so that it can catch up while keeping its phase. To drop the missed periods instead, set
+ * lastWake to GetTickCount64() again.
+ */
+bool DelayUntil(uint64_t* lastWake, uintd_t period)
+{
+    *lastWake += period;
+
+    return DelayCurrentTaskUntil(*lastWake);
+}
+
+/*
+ * Returns the task that is currently running
+ */
+Task_t* GetCurrentTask()
+{
+    return CurrentTask;
+}
+
+/*
+ * Add a task to a blocked list, keeping it in priority order. Tasks of the same priority
+ * stay in the order they blocked.
+ */
+static void InsertBlocked(ListHead_t* blockList, Task_t* task)
+{
+    List_t* list = blockList->head;
+
+    while(list != NULL && ((Task_t*)list->owner)->priority >= task->priority)
+    {
+        list = list->next;
+    }
+
+    InsertBeforeInList(blockList, list, &task->taskList);
+    task->blockedOn = blockList;
+}
+
 /*
  * This adds the current task to a list (which should unblock it later), then switches to
  * another task. This means the task will not ready until it gets unblocked from the passed list.
+ *
+ * The list is kept in priority order, and tasks of the same priority are unblocked in the order they blocked.
+ */
+void BlockCurrentTaskToList(ListHead_t* blockList)
+{
+    if(CurrentTask != NULL)
+    {
+    	ENTER_CRITICAL_SECTION;
+
+        InsertBlocked(blockList, CurrentTask);
+        SWITCH_TO_NEXT_INT; // Interrupts and calls SwitchToNextAvailableTask() from the OS stack
+
+        EXIT_CRITICAL_SECTION;
+    }
+}
+
+/*
+ * As BlockCurrentTaskToList, but if the task isn't unblocked from the list within the passed number of ticks,
+ * it's taken off the list, readied, and its timedOut flag set. The task is on SleepingTasks through its
+ * timeoutList at the same time, so whichever happens first can take it off the other list directly.
+ *
+ * A timeout of MAX_DELAY_TICKS waits forever.
  */
-void BlockCurrentTaskToList(List_t** blockList)
+void BlockCurrentTaskToListTimeout(ListHead_t* blockList, uintd_t ticks)
 {
     if(CurrentTask != NULL)
     {
     	ENTER_CRITICAL_SECTION;
 
-        AppendToList(blockList, &CurrentTask->taskList);
+        InsertBlocked(blockList, CurrentTask);
+        CurrentTask->timedOut = false;
+
+        if(ticks != MAX_DELAY_TICKS)
+        {
+            CurrentTask->timeoutList.owner = CurrentTask;
+            CurrentTask->timeoutRunning    = true;
+            InsertSleeping(CurrentTask, &CurrentTask->timeoutList, ticks);
+        }
+
         SWITCH_TO_NEXT_INT; // Interrupts and calls SwitchToNextAvailableTask() from the OS stack
 
         EXIT_CRITICAL_SECTION;
@@ -182,41 +468,147 @@ void BlockCurrentTaskToList(List_t** blockList)
 }
 
 /*
- * Loop through all the sleeping tasks and see if they can be readied.
+ * Ready any sleeping tasks whose time is up, then count down one tick for the rest.
+ *
+ * As SleepingTasks is sorted and each sleepTimer is relative to the task before it, only the
+ * front of the list ever needs to be looked at.
  */
 void UpdateSleeping()
 {
     // This is called while in a critical section, so no interrupt protection here
-    List_t* list = SleepingTasks;
+    List_t* list = SleepingTasks.head;
 
-    // For each task, check if the sleep timer is zero and ready it if so. If not, decrement timer count.
-    while(list != NULL)
+    // Every task at the front with nothing left to wait is ready to go
+    while(list != NULL && ((Task_t*)list->owner)->sleepTimer == 0)
+    {
+        WakeFrontSleepingTask();
+
+        list = SleepingTasks.head;
+    }
+
+    // Decrementing the front task counts the tick down for every task behind it as well
+    if(list != NULL)
+    {
+        ((Task_t*)list->owner)->sleepTimer--;
+    }
+}
+
+/*
+ * Returns the number of ticks since the RTOS was initialized. This wraps around, see GetTickCount64.
+ */
+uintd_t GetTickCount()
+{
+    return (uintd_t)TickCount;
+}
+
+/*
+ * Returns the number of ticks since the RTOS was initialized, as a 64-bit count that won't wrap around
+ */
+uint64_t GetTickCount64()
+{
+    uint64_t ticks;
+
+    // The count may take more than one access to read
+    ENTER_CRITICAL_SECTION;
+
+    ticks = TickCount;
+
+    EXIT_CRITICAL_SECTION;
+
+    return ticks;
+}
+
+/*
+ * Returns how many ticks can pass before the kernel next has something to do, that is,
+ * before a sleeping task wakes or a software timer fires.
+ */
+uintd_t TicksUntilNextWake()
+{
+    uintd_t ticks = MAX_DELAY_TICKS;
+    uintd_t timerTicks;
+
+    // This is called while in a critical section, so no interrupt protection here
+    if(SleepingTasks.head != NULL)
+    {
+        ticks = ((Task_t*)SleepingTasks.head->owner)->sleepTimer;
+    }
+
+    timerTicks = TimerTicksUntilNext();
+
+    if(timerTicks < ticks)
+    {
+        ticks = timerTicks;
+    }
+
+    return ticks;
+}
+
+/*
+ * Account for ticks that passed while the tick interrupt was stopped. This has the same effect on
+ * sleeping tasks as calling UpdateSleeping once per tick, but runs in one pass.
+ */
+void AdvanceTicks(uintd_t ticks)
+{
+    // This is called while in a critical section, so no interrupt protection here
+    List_t* list = SleepingTasks.head;
+
+    TickCount += ticks;
+
+    while(ticks > 0 && list != NULL)
     {
         Task_t* task = (Task_t*)list->owner;
-        List_t* next = list->next;
 
         if(task->sleepTimer == 0)
         {
-            RemoveFromList(&SleepingTasks, list);
-            AppendToList(&ReadyTasks[task->priority], list);
+            WakeFrontSleepingTask();
         }
-
-        if(task->sleepTimer > 0)
+        else if(task->sleepTimer > ticks)
+        {
+            task->sleepTimer -= ticks;
+            ticks = 0;
+        }
+        else
         {
-            task->sleepTimer--;
+            ticks -= task->sleepTimer;
+            task->sleepTimer = 0;
         }
 
-        list = next;
+        list = SleepingTasks.head;
     }
 }
 
+/*
+ * Called from the idle task when TICKLESS_IDLE is defined. If nothing else can run, the tick is
+ * stopped until the next sleeping task or software timer is due, and the tick count is fixed up
+ * once we wake.
+ */
+void TicklessIdle()
+{
+    uintd_t ticks;
+
+    ENTER_CRITICAL_SECTION;
+
+    // Only the idle task may be runnable, anything else would need the tick for time-slicing
+    if(CurrentTask == &idleTask && ReadyGroups == 0)
+    {
+        ticks = TicksUntilNextWake();
+
+        if(ticks >= TICKLESS_MIN_IDLE_TICKS)
+        {
+            AdvanceTicks(PortSuppressTicks(ticks));
+        }
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
 /*
  * This removes all tasks that are on the passed list and readies them
  * We do all of them rather than just the highest priority task to help prevent deadlocks
  */
-void ReadyTaskEntireList(List_t** taskList)
+void ReadyTaskEntireList(ListHead_t* taskList)
 {
-    List_t* list = *taskList;
+    List_t* list = taskList->head;
 
     ENTER_CRITICAL_SECTION;
 
@@ -227,7 +619,8 @@ void ReadyTaskEntireList(List_t** taskList)
         List_t* next = list->next;
 
         RemoveFromList(taskList, list);
-        AppendToList(&ReadyTasks[task->priority], list);
+        CancelTimeout(task);
+        AddToReadyList(task);
 
         list = next;
     }
@@ -235,6 +628,80 @@ void ReadyTaskEntireList(List_t** taskList)
     EXIT_CRITICAL_SECTION;
 }
 
+/*
+ * Change a task's priority. If the task is ready it moves to the end of its new priority's ready list, and if
+ * it's blocked it moves to its new place on the list it's blocked on, so that it's woken in priority order.
+ * Used by mutexes for priority inheritance, the priority the task was started with stays in basePriority.
+ */
+void SetTaskPriority(Task_t* task, uintd_t priority)
+{
+    ENTER_CRITICAL_SECTION;
+
+    if(task->ready)
+    {
+        RemoveFromList(&ReadyTasks[task->priority], &task->taskList);
+
+        if(ReadyTasks[task->priority].head == NULL)
+        {
+            MarkPriorityEmpty(task->priority);
+        }
+
+        task->priority = priority;
+        AddToEndOfReadyList(task);
+    }
+    else if(task->blockedOn != NULL)
+    {
+        RemoveFromList(task->blockedOn, &task->taskList);
+
+        task->priority = priority;
+        InsertBlocked(task->blockedOn, task);
+    }
+    else
+    {
+        task->priority = priority;
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Take the passed task off the list it's blocked on and ready it
+ */
+void ReadyTask(ListHead_t* taskList, Task_t* task)
+{
+    ENTER_CRITICAL_SECTION;
+
+    RemoveFromList(taskList, &task->taskList);
+    CancelTimeout(task);
+    AddToReadyList(task);
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Readies only the highest priority task on the passed list, which is at the front, and returns it.
+ * Returns NULL if there are no tasks on the list.
+ */
+Task_t* ReadyHighestPriorityTask(ListHead_t* taskList)
+{
+    Task_t* task = NULL;
+
+    ENTER_CRITICAL_SECTION;
+
+    if(taskList->head != NULL)
+    {
+        task = (Task_t*)taskList->head->owner;
+
+        RemoveFront(taskList);
+        CancelTimeout(task);
+        AddToReadyList(task);
+    }
+
+    EXIT_CRITICAL_SECTION;
+
+    return task;
+}
+
 // While the next two functions are similar, they are kept separate in case they
 // change as they are doing fundamentally different things
 
@@ -245,29 +712,18 @@ void ReadyTaskEntireList(List_t** taskList)
  */
 void SwitchToNextAvailableTask()
 {
-    Task_t* nextTask = NULL;
-    uintd_t i;
+    int32_t highest;
 
     ENTER_CRITICAL_SECTION;
 
-    for(i = NUM_PRIORITY_LEVELS - 1; i >= 0; i--)
-    {
-        if(ReadyTasks[i] != NULL)
-        {
-            nextTask = (Task_t*)(ReadyTasks[i])->owner;
-            break;
-        }
-    }
+    highest = HighestReadyPriority();
 
     // There should always be a next available task (namely, the idle task), but handle this anyway
-    if(nextTask != NULL)
+    if(highest >= 0)
     {
-    	//
         CurrentTask->stackPtr = TaskStackPtr;
-        RemoveFront(&ReadyTasks[nextTask->priority]);
-
-        CurrentTask = nextTask;
-        TaskStackPtr = nextTask->stackPtr;
+        CurrentTask = TakeFromReadyList(highest);
+        TaskStackPtr = CurrentTask->stackPtr;
     }
 
     EXIT_CRITICAL_SECTION;
@@ -284,9 +740,8 @@ void SwitchToNextAvailableTask()
  */
 void SwitchToHighestPriorityTaskFromISR()
 {
-    Task_t* nextTask = NULL;
-    uint8_t curPriority = 0;
-    uint8_t i;
+    int32_t curPriority = 0;
+    int32_t highest;
 
     ENTER_CRITICAL_SECTION;
 
@@ -297,21 +752,14 @@ void SwitchToHighestPriorityTaskFromISR()
         curPriority = CurrentTask->priority;
     }
 
-    for(i = NUM_PRIORITY_LEVELS - 1; i >= curPriority; i--)
-    {
-        if(ReadyTasks[i] != NULL)
-        {
-            nextTask = (Task_t*)(ReadyTasks[i])->owner;
-            break;
-        }
-    }
+    highest = HighestReadyPriority();
 
-    if(nextTask != NULL)
+    if(highest >= curPriority)
     {
-        CurrentTask->stackPtr = TaskStackPtr;
-        RemoveFront(&ReadyTasks[nextTask->priority]);
+        Task_t* nextTask = TakeFromReadyList(highest);
 
-        AppendToEndOfList(&ReadyTasks[CurrentTask->priority], &CurrentTask->taskList);
+        CurrentTask->stackPtr = TaskStackPtr;
+        AddToEndOfReadyList(CurrentTask);
 
         CurrentTask = nextTask;
         TaskStackPtr = nextTask->stackPtr;
@@ -0,0 +1,91 @@
+// 2015 Adam Jesionowski
+
+#include "semaphore.h"
+#include "rtos.h"
+#include "port.h"
+
+void InitSemaphore(Semaphore_t* sem, int32_t count)
+{
+    sem->count = count;
+    InitList(&sem->blockedTasks);
+}
+
+/*
+ * Take a unit if there is one, without blocking. Returns true if there wasn't.
+ */
+bool SemaphoreTryTake(Semaphore_t* sem)
+{
+    int32_t count = ATOMIC_LOAD_ACQUIRE(&sem->count);
+
+    // A failed exchange reloads count, so this only goes round again if someone else changed it
+    while(count > 0)
+    {
+        if(ATOMIC_COMPARE_EXCHANGE(&sem->count, &count, count - 1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Take a unit, blocking until one is given if there are none
+ */
+void SemaphoreTake(Semaphore_t* sem)
+{
+    int32_t count;
+
+    if(!SemaphoreTryTake(sem))
+    {
+        return;
+    }
+
+    ENTER_CRITICAL_SECTION;
+
+    // Count ourselves in. If a unit was given since we looked, this takes it, otherwise the count goes
+    // negative to show we're waiting. Givers can't run again until we're on the blocked list.
+    count = ATOMIC_LOAD_ACQUIRE(&sem->count);
+
+    while(!ATOMIC_COMPARE_EXCHANGE(&sem->count, &count, count - 1))
+    {
+    }
+
+    if(count <= 0)
+    {
+        // The giver hands us its unit, so it's ours by the time we run again
+        BlockCurrentTaskToList(&sem->blockedTasks);
+    }
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Give a unit back, readying the highest priority waiting task if there is one. Returns true if a task was readied.
+ */
+static bool Give(Semaphore_t* sem)
+{
+    int32_t count = ATOMIC_LOAD_ACQUIRE(&sem->count);
+
+    while(!ATOMIC_COMPARE_EXCHANGE(&sem->count, &count, count + 1))
+    {
+    }
+
+    // Only a count that was negative means a task is waiting
+    if(count < 0)
+    {
+        return ReadyHighestPriorityTask(&sem->blockedTasks) != NULL;
+    }
+
+    return false;
+}
+
+void SemaphoreGive(Semaphore_t* sem)
+{
+    Give(sem);
+}
+
+bool SemaphoreGiveFromISR(Semaphore_t* sem)
+{
+    return Give(sem);
+}
@@ -36,6 +36,19 @@ typedef uint32_t uintd_t;
 
 #define PRIORITY_IDLE PRIORITY_0
 
+// Count leading zeros of a non-zero uintd_t. The scheduler uses this to find the highest ready priority,
+// so it should map to a single instruction where the processor has one (e.g. clz on MIPS32).
+#define COUNT_LEADING_ZEROS(x) ((uintd_t)__builtin_clz(x))
+
+// Atomic accesses for the lock free ring buffer. Loads that acquire and stores that release are enough to pass
+// elements between one producer and one consumer, the fence orders a store before a following load.
+#define ATOMIC_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_FENCE()              __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Compare and swap for semaphores: if *p equals *e, store d and return true. Otherwise copy *p to *e and return false.
+#define ATOMIC_COMPARE_EXCHANGE(p, e, d) __atomic_compare_exchange_n((p), (e), (d), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
 // Stack
 #define DFLT_STACK_SIZE	200
 #define OS_STACK_SIZE	800
@@ -44,16 +57,23 @@ typedef uint32_t uintd_t;
 #define RUNTESTS
 
 
-typedef enum {
-	SWTimer1 = 0,
-	SWTimer2,
-	SWTimer3,
-	NUM_TIMERS
-} SW_TIMER;
-
 typedef uintd_t TIME;
 #define TIMER_MAX  4294967295U // 32-bit uint max
 
+// Number of hardware timer counts in one tick
+#define TIMER_COUNTS_PER_TICK 100
+
+// Define this to stop the tick while only the idle task can run. The port must implement PortSuppressTicks.
+#define TICKLESS_IDLE
+
+// Don't bother suppressing the tick unless at least this many ticks can be skipped
+#define TICKLESS_MIN_IDLE_TICKS 2
+
+// Define this to call software timer callbacks from a task, rather than the timer interrupt. See timerDaemon.h.
+#define TIMER_DAEMON
+#define TIMER_DAEMON_PRIORITY   PRIORITY_5
+#define TIMER_DAEMON_QUEUE_SIZE 4
+
 extern TIME timerReg;
 #define READ_TIMER_REGISTER() timerReg
 
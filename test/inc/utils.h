@@ -10,5 +10,6 @@
 
 List_t* makeNode(void* owner);
 Task_t* makeTask(uintd_t timer, uint8_t prio);
+void RunTask(Task_t* task, uint8_t prio);
 
 #endif /* UTILS_H_ */
@@ -22,3 +22,20 @@ void PortStartHardwareTimer(TIME time)
 {
 	hwTime = time;
 }
+
+// Simulated tickless idle. The last request is recorded, and the sleep is cut short
+// after ticksUntilInterrupt ticks to simulate another interrupt waking us early.
+uintd_t ticksSuppressed;
+uintd_t ticksUntilInterrupt = MAX_DELAY_TICKS;
+
+uintd_t PortSuppressTicks(uintd_t ticks)
+{
+	ticksSuppressed = ticks;
+
+	if(ticksUntilInterrupt < ticks)
+	{
+		return ticksUntilInterrupt;
+	}
+
+	return ticks;
+}
@@ -4,7 +4,9 @@
 #include "queue.h"
 #include "rtos.h"
 #include "idleTask.h"
+#include "utils.h"
 #include <iostream>
+#include <string.h>
 
 #define SIZE 25
 
@@ -48,12 +50,12 @@ TEST_GROUP(BlockingQueue)
 
     void CheckBlockedOnWrite(List_t* expected)
     {
-        POINTERS_EQUAL(queue.tasksBlockedOnWrite, expected);
+        POINTERS_EQUAL(queue.tasksBlockedOnWrite.head, expected);
     }
 
     void CheckBlockedOnRead(List_t* expected)
     {
-        POINTERS_EQUAL(queue.tasksBlockedOnRead, expected);
+        POINTERS_EQUAL(queue.tasksBlockedOnRead.head, expected);
     }
 };
 
@@ -90,6 +92,306 @@ TEST(BlockingQueue, BlockOnFull)
 }
 
 
+/*
+ * A task blocked on an empty queue gets the next enqueued element directly, and the queue stays empty
+ */
+TEST(BlockingQueue, HandoffToReader)
+{
+    uint32_t insert = 0xDEADBEEF;
+    uint32_t val = 0;
+
+    DequeueBlocking(&queue, (uint8_t*)&val);
+    POINTERS_EQUAL(&val, idleTask.waitData);
+
+    CHECK_FALSE(Enqueue(&queue, (uint8_t*)&insert));
+
+    LONGS_EQUAL(0xDEADBEEF, val);
+    POINTERS_EQUAL(NULL, idleTask.waitData);
+    CheckFrontAndCount(0, 0);
+    CheckBlockedOnRead(NULL);
+}
+
+/*
+ * With several readers waiting, one enqueue only wakes the highest priority one
+ */
+TEST(BlockingQueue, OnlyHighestReaderWoken)
+{
+    Task_t   low;
+    Task_t   high;
+    uint32_t lowVal = 0;
+    uint32_t highVal = 0;
+    uint32_t insert = 0xDEADBEEF;
+
+    RunTask(&low, PRIORITY_1);
+    DequeueBlocking(&queue, (uint8_t*)&lowVal);
+    RunTask(&high, PRIORITY_2);
+    DequeueBlocking(&queue, (uint8_t*)&highVal);
+
+    CheckBlockedOnRead(&high.taskList);
+
+    Enqueue(&queue, (uint8_t*)&insert);
+
+    LONGS_EQUAL(0xDEADBEEF, highVal);
+    LONGS_EQUAL(0, lowVal);
+    CheckBlockedOnRead(&low.taskList);
+    POINTERS_EQUAL(&lowVal, low.waitData);
+    CheckFrontAndCount(0, 0);
+}
+
+/*
+ * A task blocked on a full queue has its element moved in by the next dequeue
+ */
+TEST(BlockingQueue, HandoffFromWriter)
+{
+    uint32_t insert = 0xDEADBEEF;
+    uint32_t dequeue = 0;
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&insert);
+    }
+
+    insert = 0xFEEDBEEF;
+    EnqueueBlocking(&queue, (uint8_t*)&insert);
+    CheckBlockedOnWrite(&idleTask.taskList);
+
+    CHECK_FALSE(Dequeue(&queue, (uint8_t*)&dequeue));
+
+    LONGS_EQUAL(0xDEADBEEF, dequeue);
+    POINTERS_EQUAL(NULL, idleTask.waitData);
+    CheckBlockedOnWrite(NULL);
+    CheckFrontAndCount(1, SIZE);
+    CheckDataAt(0, 0xFEEDBEEF);
+}
+
+/*
+ * A task waiting to reserve a slot is readied once there's space, without anything being copied for it
+ */
+TEST(BlockingQueue, ReserveBlocksWhenFull)
+{
+    uint32_t val = 0xDEADBEEF;
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&val);
+    }
+
+    POINTERS_EQUAL(NULL, QueueReserveBlocking(&queue));
+    CheckBlockedOnWrite(&idleTask.taskList);
+    POINTERS_EQUAL(NULL, idleTask.waitData);
+
+    Dequeue(&queue, (uint8_t*)&val);
+
+    CheckBlockedOnWrite(NULL);
+    CheckFrontAndCount(1, SIZE - 1);
+    POINTERS_EQUAL(&data[0], QueueReserveBlocking(&queue));
+}
+
+/*
+ * Committing an element hands it to a task blocked on dequeue
+ */
+TEST(BlockingQueue, CommitHandsOffToReader)
+{
+    uint32_t val = 0;
+    uint32_t* slot;
+
+    DequeueBlocking(&queue, (uint8_t*)&val);
+
+    slot  = (uint32_t*)QueueReserve(&queue);
+    *slot = 0xDEADBEEF;
+    QueueCommit(&queue);
+
+    LONGS_EQUAL(0xDEADBEEF, val);
+    CheckBlockedOnRead(NULL);
+    CheckFrontAndCount(1, 0);
+}
+
+/*
+ * A task waiting to acquire is readied by an enqueue, which leaves the element in the queue for it
+ */
+TEST(BlockingQueue, AcquireBlocksWhenEmpty)
+{
+    uint32_t val = 0xDEADBEEF;
+
+    POINTERS_EQUAL(NULL, QueuePeekAcquireBlocking(&queue));
+    CheckBlockedOnRead(&idleTask.taskList);
+
+    Enqueue(&queue, (uint8_t*)&val);
+
+    CheckBlockedOnRead(NULL);
+    CheckFrontAndCount(0, 1);
+    POINTERS_EQUAL(&data[0], QueuePeekAcquireBlocking(&queue));
+}
+
+/*
+ * A task that blocked on dequeue because the front element was acquired gets the next element on release
+ */
+TEST(BlockingQueue, ReleaseWakesReader)
+{
+    Task_t   task;
+    uint32_t insert = 100;
+    uint32_t val = 0;
+
+    Enqueue(&queue, (uint8_t*)&insert);
+    insert++;
+    Enqueue(&queue, (uint8_t*)&insert);
+
+    QueuePeekAcquire(&queue);
+
+    RunTask(&task, PRIORITY_1);
+    DequeueBlocking(&queue, (uint8_t*)&val);
+    CheckBlockedOnRead(&task.taskList);
+
+    QueueRelease(&queue);
+
+    LONGS_EQUAL(101, val);
+    CheckBlockedOnRead(NULL);
+    CheckFrontAndCount(2, 0);
+}
+
+/*
+ * A batch dequeue blocks until its minimum is met, and a batch enqueue wakes it once
+ */
+TEST(BlockingQueue, DequeueManyMinimum)
+{
+    Task_t   task;
+    uint32_t in[4] = { 1, 2, 3, 4 };
+    uint32_t out[4] = { 0, 0, 0, 0 };
+
+    Enqueue(&queue, (uint8_t*)&in[0]);
+
+    RunTask(&task, PRIORITY_1);
+
+    // One element is taken straight away, then we wait for the others
+    LONGS_EQUAL(1, DequeueManyBlocking(&queue, (uint8_t*)out, 4, 3));
+    LONGS_EQUAL(1, out[0]);
+    CheckBlockedOnRead(&task.taskList);
+    POINTERS_EQUAL(NULL, task.waitData);
+
+    LONGS_EQUAL(3, EnqueueMany(&queue, (uint8_t*)&in[1], 3));
+
+    // The waiting task is readied to collect them itself
+    CheckBlockedOnRead(NULL);
+    CheckFrontAndCount(1, 3);
+}
+
+/*
+ * A batch enqueue into a full queue blocks, and is readied when a batch dequeue frees space
+ */
+TEST(BlockingQueue, EnqueueManyBlocksWhenFull)
+{
+    uint32_t in[SIZE + 2];
+    uint32_t out[2];
+
+    for(int i = 0; i < SIZE + 2; i++)
+    {
+        in[i] = i;
+    }
+
+    LONGS_EQUAL(SIZE, EnqueueManyBlocking(&queue, (uint8_t*)in, SIZE + 2, SIZE + 2));
+    CheckBlockedOnWrite(&idleTask.taskList);
+
+    LONGS_EQUAL(2, DequeueMany(&queue, (uint8_t*)out, 2));
+    CheckBlockedOnWrite(NULL);
+    CheckFrontAndCount(2, SIZE - 2);
+}
+
+/*
+ * Tasks waiting on single elements are handed them from a batch, highest priority first
+ */
+TEST(BlockingQueue, EnqueueManyHandsOff)
+{
+    Task_t   low;
+    Task_t   high;
+    uint32_t lowVal = 0;
+    uint32_t highVal = 0;
+    uint32_t in[3] = { 1, 2, 3 };
+
+    RunTask(&low, PRIORITY_1);
+    DequeueBlocking(&queue, (uint8_t*)&lowVal);
+    RunTask(&high, PRIORITY_2);
+    DequeueBlocking(&queue, (uint8_t*)&highVal);
+
+    LONGS_EQUAL(3, EnqueueMany(&queue, (uint8_t*)in, 3));
+
+    LONGS_EQUAL(1, highVal);
+    LONGS_EQUAL(2, lowVal);
+    CheckBlockedOnRead(NULL);
+    CheckFrontAndCount(2, 1);
+    CheckDataAt(2, 3);
+}
+
+/*
+ * A dequeue with a timeout gives up if nothing is enqueued in time
+ */
+TEST(BlockingQueue, DequeueTimeoutExpires)
+{
+    Task_t   task;
+    uint32_t val = 0;
+
+    RunTask(&task, PRIORITY_1);
+
+    CHECK_TRUE(DequeueBlockingTimeout(&queue, (uint8_t*)&val, 0));
+
+    DequeueBlockingTimeout(&queue, (uint8_t*)&val, 1);
+    CheckBlockedOnRead(&task.taskList);
+
+    Tick();
+    Tick();
+
+    CHECK_TRUE(task.timedOut);
+    CheckBlockedOnRead(NULL);
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+/*
+ * An element handed to a task waiting with a timeout cancels the timeout
+ */
+TEST(BlockingQueue, DequeueTimeoutHandoff)
+{
+    Task_t   task;
+    uint32_t insert = 0xDEADBEEF;
+    uint32_t val = 0;
+
+    RunTask(&task, PRIORITY_1);
+
+    DequeueBlockingTimeout(&queue, (uint8_t*)&val, 5);
+    Enqueue(&queue, (uint8_t*)&insert);
+
+    LONGS_EQUAL(0xDEADBEEF, val);
+    CHECK_FALSE(task.timedOut);
+    POINTERS_EQUAL(NULL, task.blockedOn);
+    LONGS_EQUAL(MAX_DELAY_TICKS, TicksUntilNextWake());
+}
+
+/*
+ * An enqueue with a timeout into a full queue gives up in time, leaving the queue as it was
+ */
+TEST(BlockingQueue, EnqueueTimeoutExpires)
+{
+    Task_t   task;
+    uint32_t val = 0xDEADBEEF;
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&val);
+    }
+
+    RunTask(&task, PRIORITY_1);
+
+    CHECK_TRUE(EnqueueBlockingTimeout(&queue, (uint8_t*)&val, 0));
+
+    EnqueueBlockingTimeout(&queue, (uint8_t*)&val, 1);
+    CheckBlockedOnWrite(&task.taskList);
+
+    Tick();
+    Tick();
+
+    CHECK_TRUE(task.timedOut);
+    CheckBlockedOnWrite(NULL);
+    CheckFrontAndCount(0, SIZE);
+}
+
 // Below are tests from testQueue replicated with the blocking methods that don't run into a block
 
 /*
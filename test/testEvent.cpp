@@ -0,0 +1,213 @@
+// 2015 Adam Jesionowski
+
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "event.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "utils.h"
+
+TEST_GROUP(Event)
+{
+    Event_t event;
+    Task_t  task;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        InitEvent(&event);
+
+        RunTask(&task, PRIORITY_1);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * Triggering an event readies the waiting task
+ */
+TEST(Event, WaitTrigger)
+{
+    WaitForEvent(&event);
+    POINTERS_EQUAL(&task.taskList, event.blockedTasks.head);
+
+    TriggerEvent(&event);
+    POINTERS_EQUAL(NULL, event.blockedTasks.head);
+}
+
+/*
+ * InitEvent sets up an event that didn't start out zeroed
+ */
+TEST(Event, Init)
+{
+    Event_t other;
+
+    memset(&other, 0xFF, sizeof(other));
+    InitEvent(&other);
+
+    POINTERS_EQUAL(NULL, other.blockedTasks.head);
+    POINTERS_EQUAL(NULL, other.set);
+
+    TriggerEvent(&other);
+}
+
+/*
+ * Waiting with a timeout gives up if the event isn't triggered in time
+ */
+TEST(Event, WaitTimeoutExpires)
+{
+    CHECK_TRUE(WaitForEventTimeout(&event, 0));
+
+    WaitForEventTimeout(&event, 1);
+    POINTERS_EQUAL(&task.taskList, event.blockedTasks.head);
+
+    Tick();
+    Tick();
+
+    CHECK_TRUE(task.timedOut);
+    POINTERS_EQUAL(NULL, event.blockedTasks.head);
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+/*
+ * Triggering the event before the timeout cancels it
+ */
+TEST(Event, WaitTimeoutTriggered)
+{
+    WaitForEventTimeout(&event, 3);
+    TriggerEvent(&event);
+
+    CHECK_FALSE(task.timedOut);
+    LONGS_EQUAL(MAX_DELAY_TICKS, TicksUntilNextWake());
+
+    Tick();
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+TEST_GROUP(EventGroup)
+{
+    EventGroup_t group;
+    Task_t       anyTask;
+    Task_t       allTask;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        InitEventGroup(&group);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * InitEventGroup sets up a group that didn't start out zeroed
+ */
+TEST(EventGroup, Init)
+{
+    EventGroup_t other;
+
+    memset(&other, 0xFF, sizeof(other));
+    InitEventGroup(&other);
+
+    LONGS_EQUAL(0, other.bits);
+    POINTERS_EQUAL(NULL, other.blockedTasks.head);
+
+    CHECK_FALSE(SetBits(&other, 0x1));
+    LONGS_EQUAL(0x1, other.bits);
+}
+
+/*
+ * A wait that's already met doesn't block
+ */
+TEST(EventGroup, AlreadySet)
+{
+    RunTask(&anyTask, PRIORITY_1);
+
+    SetBits(&group, 0x5);
+
+    LONGS_EQUAL(0x5, WaitBits(&group, 0x4, false, false));
+    LONGS_EQUAL(0x5, WaitBits(&group, 0x5, true, true));
+
+    LONGS_EQUAL(0, group.bits);
+    POINTERS_EQUAL(&anyTask, GetCurrentTask());
+}
+
+/*
+ * A task waiting for any bit wakes on the first, a task waiting for all of them only once the last is set
+ */
+TEST(EventGroup, AnyAndAll)
+{
+    RunTask(&anyTask, PRIORITY_1);
+    WaitBits(&group, 0x3, false, false);
+
+    RunTask(&allTask, PRIORITY_2);
+    WaitBits(&group, 0x3, true, false);
+
+    POINTERS_EQUAL(&idleTask, GetCurrentTask());
+
+    // Bits outside both masks wake nobody
+    CHECK_FALSE(SetBits(&group, 0x4));
+    POINTERS_EQUAL(&allTask.taskList, group.blockedTasks.head);
+    POINTERS_EQUAL(&anyTask.taskList, group.blockedTasks.tail);
+
+    CHECK_TRUE(SetBits(&group, 0x1));
+    POINTERS_EQUAL(&allTask.taskList, group.blockedTasks.head);
+    POINTERS_EQUAL(&allTask.taskList, group.blockedTasks.tail);
+    LONGS_EQUAL(0x5, anyTask.eventBits);
+
+    CHECK_TRUE(SetBits(&group, 0x2));
+    POINTERS_EQUAL(NULL, group.blockedTasks.head);
+    LONGS_EQUAL(0x7, allTask.eventBits);
+
+    Tick();
+    POINTERS_EQUAL(&allTask, GetCurrentTask());
+}
+
+/*
+ * Bits cleared on exit are only cleared after every task met by the same SetBits has seen them
+ */
+TEST(EventGroup, ClearOnExit)
+{
+    RunTask(&anyTask, PRIORITY_1);
+    WaitBits(&group, 0x1, false, true);
+
+    RunTask(&allTask, PRIORITY_2);
+    WaitBits(&group, 0x3, true, false);
+
+    SetBits(&group, 0x3);
+
+    POINTERS_EQUAL(NULL, group.blockedTasks.head);
+    LONGS_EQUAL(0x3, anyTask.eventBits);
+    LONGS_EQUAL(0x3, allTask.eventBits);
+    LONGS_EQUAL(0x2, group.bits);
+
+    ClearBits(&group, 0x2);
+    LONGS_EQUAL(0, group.bits);
+}
+
+/*
+ * An interrupt setting bits can switch straight to the task it readied
+ */
+TEST(EventGroup, SetFromISR)
+{
+    RunTask(&anyTask, PRIORITY_1);
+    WaitBits(&group, 0x80, false, true);
+
+    CHECK_TRUE(SetBits(&group, 0x80));
+    SwitchToHighestPriorityTaskFromISR();
+
+    POINTERS_EQUAL(&anyTask, GetCurrentTask());
+    LONGS_EQUAL(0, group.bits);
+}
@@ -8,18 +8,19 @@
 
 TEST_GROUP(List)
 {
-	List_t* root = NULL;
+	ListHead_t root;
 	List_t* first;
 
 	void setup()
 	{
+	    InitList(&root);
 	    first = makeNode(NULL);
 	    AppendToList(&root, first);
 	}
 
 	void teardown()
 	{
-	    root = NULL;
+	    InitList(&root);
 	    free(first);
 	}
 
@@ -39,7 +40,8 @@ TEST_GROUP(List)
  */
 TEST(List, RootOk)
 {
-   POINTERS_EQUAL(first, root);
+   POINTERS_EQUAL(first, root.head);
+   POINTERS_EQUAL(first, root.tail);
 }
 
 /*
@@ -50,7 +52,8 @@ TEST(List, AppendOne)
 	List_t* second = makeNode(NULL);
 	AppendToList(&root, second);
 
-	POINTERS_EQUAL(root, second);           // Root is now the just added node
+	POINTERS_EQUAL(root.head, second);      // Root is now the just added node
+	POINTERS_EQUAL(root.tail, first);       // And first is still the end
 	POINTERS_EQUAL(second->next, first);    // Make sure we link up to first
 	POINTERS_EQUAL(first->prev, second);
 
@@ -67,7 +70,8 @@ TEST(List, AppendTwo)
 	AppendToList(&root, second);
 	AppendToList(&root, third);
 
-	POINTERS_EQUAL(root, third);
+	POINTERS_EQUAL(root.head, third);
+	POINTERS_EQUAL(root.tail, first);
 	POINTERS_EQUAL(third->next->next, first);
 	POINTERS_EQUAL(first->prev->prev, third);
 
@@ -81,7 +85,8 @@ TEST(List, AppendTwo)
 TEST(List, RemoveRoot)
 {
 	RemoveFromList(&root, first);
-	POINTERS_EQUAL(root, NULL);
+	POINTERS_EQUAL(root.head, NULL);
+	POINTERS_EQUAL(root.tail, NULL);
 }
 
 /*
@@ -93,8 +98,9 @@ TEST(List, RemoveLast)
 	AppendToList(&root, second);
 
 	RemoveFromList(&root, first);
-	POINTERS_EQUAL(root, second);
-	POINTERS_EQUAL(root->next, NULL);
+	POINTERS_EQUAL(root.head, second);
+	POINTERS_EQUAL(root.tail, second);
+	POINTERS_EQUAL(root.head->next, NULL);
 }
 
 /*
@@ -106,8 +112,9 @@ TEST(List, RemoveFirst)
 	AppendToList(&root, second);
 
 	RemoveFromList(&root, second);
-	POINTERS_EQUAL(root, first);
-	POINTERS_EQUAL(root->next, NULL);
+	POINTERS_EQUAL(root.head, first);
+	POINTERS_EQUAL(root.tail, first);
+	POINTERS_EQUAL(root.head->next, NULL);
 }
 
 /*
@@ -119,8 +126,9 @@ TEST(List, RemoveFirstMethod)
 	AppendToList(&root, second);
 
 	RemoveFront(&root);
-	POINTERS_EQUAL(root, first);
-	POINTERS_EQUAL(root->next, NULL);
+	POINTERS_EQUAL(root.head, first);
+	POINTERS_EQUAL(root.tail, first);
+	POINTERS_EQUAL(root.head->next, NULL);
 }
 
 /*
@@ -134,9 +142,9 @@ TEST(List, RemoveMid)
 	AppendToList(&root, third);
 
 	RemoveFromList(&root, second);
-	POINTERS_EQUAL(root, third);
-	POINTERS_EQUAL(root->next, first);
-	POINTERS_EQUAL(first->prev, root);
+	POINTERS_EQUAL(root.head, third);
+	POINTERS_EQUAL(root.head->next, first);
+	POINTERS_EQUAL(first->prev, root.head);
 }
 
 /*
@@ -151,7 +159,8 @@ TEST(List, AppendToEnd)
 	AppendToList(&root, second);
 	AppendToEndOfList(&root, third);
 
-	POINTERS_EQUAL(root, second);
+	POINTERS_EQUAL(root.head, second);
+	POINTERS_EQUAL(root.tail, third);
 	POINTERS_EQUAL(third, second->next->next);
 	POINTERS_EQUAL(first, second->next);
 
@@ -159,6 +168,86 @@ TEST(List, AppendToEnd)
 	free(third);
 }
 
+/*
+ * Add to the end of an empty list using AppendToEnd
+ */
+TEST(List, AppendToEndEmpty)
+{
+	List_t* second = makeNode(NULL);
+
+	RemoveFront(&root);
+	AppendToEndOfList(&root, second);
+
+	POINTERS_EQUAL(root.head, second);
+	POINTERS_EQUAL(root.tail, second);
+	POINTERS_EQUAL(second->prev, NULL);
+	POINTERS_EQUAL(second->next, NULL);
+
+	free(second);
+}
+
+/*
+ * Remove the tail of the list, the node before it should become the tail
+ */
+TEST(List, RemoveTail)
+{
+	List_t* second = makeNode(NULL);
+	AppendToEndOfList(&root, second);
+
+	RemoveFromList(&root, second);
+	POINTERS_EQUAL(root.head, first);
+	POINTERS_EQUAL(root.tail, first);
+	POINTERS_EQUAL(first->next, NULL);
+
+	// Appending to the end again should link after first
+	AppendToEndOfList(&root, second);
+	POINTERS_EQUAL(first->next, second);
+	POINTERS_EQUAL(root.tail, second);
+
+	free(second);
+}
+
+/*
+ * Insert a node in front of another one
+ */
+TEST(List, InsertBefore)
+{
+	// second->third->first
+	List_t* second = makeNode(NULL);
+	List_t* third = makeNode(NULL);
+	AppendToList(&root, second);
+	InsertBeforeInList(&root, first, third);
+
+	POINTERS_EQUAL(root.head, second);
+	POINTERS_EQUAL(root.tail, first);
+	POINTERS_EQUAL(second->next, third);
+	POINTERS_EQUAL(third->next, first);
+	POINTERS_EQUAL(first->prev, third);
+	POINTERS_EQUAL(third->prev, second);
+
+	free(second);
+	free(third);
+}
+
+/*
+ * Inserting in front of the head or of NULL adds to the front or end respectively
+ */
+TEST(List, InsertBeforeEnds)
+{
+	List_t* second = makeNode(NULL);
+	List_t* third = makeNode(NULL);
+	InsertBeforeInList(&root, first, second);
+	InsertBeforeInList(&root, NULL, third);
+
+	POINTERS_EQUAL(root.head, second);
+	POINTERS_EQUAL(root.tail, third);
+	POINTERS_EQUAL(second->next, first);
+	POINTERS_EQUAL(first->next, third);
+
+	free(second);
+	free(third);
+}
+
 /*
  * Check whether a node is in the list
  */
@@ -0,0 +1,258 @@
+// 2015 Adam Jesionowski
+
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "mutex.h"
+#include "semaphore.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "utils.h"
+
+TEST_GROUP(Mutex)
+{
+    Mutex_t mutex;
+    Mutex_t mutex2;
+    Task_t  low;
+    Task_t  medium;
+    Task_t  high;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        InitMutex(&mutex);
+        InitMutex(&mutex2);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * InitMutex sets up a mutex that didn't start out zeroed
+ */
+TEST(Mutex, Init)
+{
+    Mutex_t other;
+
+    memset(&other, 0xFF, sizeof(other));
+    InitMutex(&other);
+
+    POINTERS_EQUAL(NULL, other.owner);
+    POINTERS_EQUAL(NULL, other.blockedTasks.head);
+
+    RunTask(&low, PRIORITY_1);
+    CHECK_FALSE(MutexTryLock(&other));
+    POINTERS_EQUAL(&low, other.owner);
+}
+
+/*
+ * Lock and unlock with nobody else waiting
+ */
+TEST(Mutex, LockUnlock)
+{
+    RunTask(&low, PRIORITY_1);
+
+    MutexLock(&mutex);
+    POINTERS_EQUAL(&low, mutex.owner);
+
+    // It's already locked
+    CHECK_TRUE(MutexTryLock(&mutex));
+
+    CHECK_FALSE(MutexUnlock(&mutex));
+    POINTERS_EQUAL(NULL, mutex.owner);
+    POINTERS_EQUAL(NULL, low.mutexesHeld.head);
+
+    // Not locked any more, so it can't be unlocked
+    CHECK_TRUE(MutexUnlock(&mutex));
+
+    CHECK_FALSE(MutexTryLock(&mutex));
+    POINTERS_EQUAL(&low, mutex.owner);
+}
+
+/*
+ * Only the owner may unlock
+ */
+TEST(Mutex, UnlockNotOwner)
+{
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+
+    RunTask(&high, PRIORITY_3);
+
+    CHECK_TRUE(MutexUnlock(&mutex));
+    POINTERS_EQUAL(&low, mutex.owner);
+}
+
+/*
+ * A low priority owner runs at the priority of the high priority task waiting on it, so a medium priority
+ * task can't hold it up
+ */
+TEST(Mutex, PriorityInheritance)
+{
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+
+    RunTask(&high, PRIORITY_3);
+    MutexLock(&mutex);
+
+    POINTERS_EQUAL(&high.taskList, mutex.blockedTasks.head);
+    LONGS_EQUAL(PRIORITY_3, low.priority);
+    POINTERS_EQUAL(&low, GetCurrentTask());
+
+    // The medium task is ready, but low keeps running
+    memset(&medium, 0, sizeof(Task_t));
+    medium.priority       = PRIORITY_2;
+    medium.taskList.owner = &medium;
+    StartTask(&medium);
+    Tick();
+
+    POINTERS_EQUAL(&low, GetCurrentTask());
+
+    // Unlocking hands the mutex to high and drops low back down
+    CHECK_FALSE(MutexUnlock(&mutex));
+
+    POINTERS_EQUAL(&high, mutex.owner);
+    POINTERS_EQUAL(NULL, high.waitingOn);
+    POINTERS_EQUAL(NULL, mutex.blockedTasks.head);
+    LONGS_EQUAL(PRIORITY_1, low.priority);
+
+    Tick();
+    POINTERS_EQUAL(&high, GetCurrentTask());
+}
+
+/*
+ * Waiters get the mutex in priority order, whatever order they locked in
+ */
+TEST(Mutex, HandOffInPriorityOrder)
+{
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+
+    RunTask(&medium, PRIORITY_2);
+    MutexLock(&mutex);
+
+    RunTask(&high, PRIORITY_3);
+    MutexLock(&mutex);
+
+    POINTERS_EQUAL(&high.taskList, mutex.blockedTasks.head);
+    POINTERS_EQUAL(&medium.taskList, mutex.blockedTasks.tail);
+    LONGS_EQUAL(PRIORITY_3, low.priority);
+
+    POINTERS_EQUAL(&low, GetCurrentTask());
+    MutexUnlock(&mutex);
+    POINTERS_EQUAL(&high, mutex.owner);
+
+    Tick();
+    POINTERS_EQUAL(&high, GetCurrentTask());
+
+    // high now holds the mutex medium is waiting for, but it's higher priority so it keeps its own
+    LONGS_EQUAL(PRIORITY_3, high.priority);
+
+    MutexUnlock(&mutex);
+    POINTERS_EQUAL(&medium, mutex.owner);
+    LONGS_EQUAL(PRIORITY_2, medium.priority);
+}
+
+/*
+ * Priority is passed down a chain of owners waiting on each other
+ */
+TEST(Mutex, ChainedInheritance)
+{
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+
+    RunTask(&medium, PRIORITY_2);
+    MutexLock(&mutex2);
+    MutexLock(&mutex);
+
+    LONGS_EQUAL(PRIORITY_2, low.priority);
+    POINTERS_EQUAL(&mutex, medium.waitingOn);
+
+    RunTask(&high, PRIORITY_3);
+    MutexLock(&mutex2);
+
+    LONGS_EQUAL(PRIORITY_3, medium.priority);
+    LONGS_EQUAL(PRIORITY_3, low.priority);
+    POINTERS_EQUAL(&low, GetCurrentTask());
+
+    // low gives up mutex to medium, which still runs at high's priority until it gives up mutex2
+    MutexUnlock(&mutex);
+    LONGS_EQUAL(PRIORITY_1, low.priority);
+    POINTERS_EQUAL(&medium, mutex.owner);
+
+    Tick();
+    POINTERS_EQUAL(&medium, GetCurrentTask());
+    LONGS_EQUAL(PRIORITY_3, medium.priority);
+
+    MutexUnlock(&mutex);
+    LONGS_EQUAL(PRIORITY_3, medium.priority);
+
+    MutexUnlock(&mutex2);
+    LONGS_EQUAL(PRIORITY_2, medium.priority);
+    POINTERS_EQUAL(&high, mutex2.owner);
+}
+
+/*
+ * An owner holding more than one mutex keeps the priority of the waiters on the ones it still holds
+ */
+TEST(Mutex, UnlockKeepsOtherInheritance)
+{
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+    MutexLock(&mutex2);
+
+    RunTask(&medium, PRIORITY_2);
+    MutexLock(&mutex2);
+
+    RunTask(&high, PRIORITY_3);
+    MutexLock(&mutex);
+
+    LONGS_EQUAL(PRIORITY_3, low.priority);
+
+    MutexUnlock(&mutex);
+    LONGS_EQUAL(PRIORITY_2, low.priority);
+
+    MutexUnlock(&mutex2);
+    LONGS_EQUAL(PRIORITY_1, low.priority);
+    POINTERS_EQUAL(&medium, mutex2.owner);
+}
+
+/*
+ * An owner blocked on something other than a mutex moves up that list when it inherits a priority
+ */
+TEST(Mutex, InheritWhileBlocked)
+{
+    Semaphore_t sem;
+
+    InitSemaphore(&sem, 0);
+
+    RunTask(&low, PRIORITY_1);
+    MutexLock(&mutex);
+
+    RunTask(&medium, PRIORITY_2);
+    SemaphoreTake(&sem);
+    POINTERS_EQUAL(&low, GetCurrentTask());
+
+    SemaphoreTake(&sem);
+    POINTERS_EQUAL(&medium.taskList, sem.blockedTasks.head);
+
+    RunTask(&high, PRIORITY_3);
+    MutexLock(&mutex);
+
+    LONGS_EQUAL(PRIORITY_3, low.priority);
+    POINTERS_EQUAL(&low.taskList, sem.blockedTasks.head);
+    POINTERS_EQUAL(&medium.taskList, sem.blockedTasks.tail);
+
+    // The owner is woken first, so it can go on to unlock
+    SemaphoreGive(&sem);
+    POINTERS_EQUAL(&medium.taskList, sem.blockedTasks.head);
+    POINTERS_EQUAL(NULL, low.blockedOn);
+
+    Tick();
+    POINTERS_EQUAL(&low, GetCurrentTask());
+}
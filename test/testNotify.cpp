@@ -0,0 +1,121 @@
+// 2015 Adam Jesionowski
+
+#include "CppUTest/TestHarness.h"
+#include "notify.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "utils.h"
+
+TEST_GROUP(Notify)
+{
+    Task_t task;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        RunTask(&task, PRIORITY_1);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * A notification sent before the task waits is taken straight away
+ */
+TEST(Notify, AlreadyPending)
+{
+    CHECK_FALSE(NotifyTask(&task, 0x3, NOTIFY_SET_BITS));
+    CHECK_TRUE(task.notifyPending);
+
+    LONGS_EQUAL(0x3, WaitNotify(0x1));
+
+    CHECK_FALSE(task.notifyPending);
+    LONGS_EQUAL(0x2, task.notifyValue);
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+/*
+ * Waiting blocks the task on its own list, and notifying it readies it
+ */
+TEST(Notify, WaitBlocks)
+{
+    WaitNotify(0);
+
+    POINTERS_EQUAL(&task.taskList, task.notifyWait.head);
+    POINTERS_EQUAL(&idleTask, GetCurrentTask());
+
+    CHECK_TRUE(NotifyTask(&task, 0x10, NOTIFY_SET_BITS));
+
+    POINTERS_EQUAL(NULL, task.notifyWait.head);
+    CHECK_TRUE(task.notifyPending);
+
+    Tick();
+    POINTERS_EQUAL(&task, GetCurrentTask());
+
+    // What the wait returns once the task runs again
+    LONGS_EQUAL(0x10, WaitNotify(~0U));
+    LONGS_EQUAL(0, task.notifyValue);
+}
+
+/*
+ * Each action changes the word in its own way
+ */
+TEST(Notify, Actions)
+{
+    NotifyTask(&task, 0x1, NOTIFY_SET_BITS);
+    NotifyTask(&task, 0x4, NOTIFY_SET_BITS);
+    LONGS_EQUAL(0x5, task.notifyValue);
+
+    NotifyTask(&task, 100, NOTIFY_INCREMENT);
+    NotifyTask(&task, 100, NOTIFY_INCREMENT);
+    LONGS_EQUAL(0x7, task.notifyValue);
+
+    NotifyTask(&task, 42, NOTIFY_OVERWRITE);
+    LONGS_EQUAL(42, task.notifyValue);
+
+    LONGS_EQUAL(42, WaitNotify(0));
+    LONGS_EQUAL(42, task.notifyValue);
+}
+
+/*
+ * An interrupt can switch straight to the task it notified
+ */
+TEST(Notify, NotifyFromISR)
+{
+    WaitNotify(0);
+
+    CHECK_TRUE(NotifyTask(&task, 1, NOTIFY_INCREMENT));
+    SwitchToHighestPriorityTaskFromISR();
+
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+/*
+ * Waiting with a timeout gives up if no notification comes in time
+ */
+TEST(Notify, WaitTimeout)
+{
+    uintd_t value = 0;
+
+    CHECK_TRUE(WaitNotifyTimeout(0, 0, &value));
+
+    NotifyTask(&task, 7, NOTIFY_OVERWRITE);
+    CHECK_FALSE(WaitNotifyTimeout(0, 0, &value));
+    LONGS_EQUAL(7, value);
+
+    CHECK_TRUE(WaitNotifyTimeout(0, 1, &value));
+    POINTERS_EQUAL(&task.taskList, task.notifyWait.head);
+
+    Tick();
+    Tick();
+
+    CHECK_TRUE(task.timedOut);
+    POINTERS_EQUAL(NULL, task.notifyWait.head);
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
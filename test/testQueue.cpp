@@ -3,6 +3,7 @@
 #include "CppUTest/TestHarness.h"
 #include "queue.h"
 #include <iostream>
+#include <string.h>
 
 #define SIZE 25
 
@@ -52,8 +53,8 @@ TEST(Queue, InitQueue)
     LONGS_EQUAL(0, queue.count);
     LONGS_EQUAL(SIZE, queue.maxSize);
     LONGS_EQUAL(sizeof(uint32_t), queue.sizeOf);
-    POINTERS_EQUAL(NULL, queue.tasksBlockedOnRead);
-    POINTERS_EQUAL(NULL, queue.tasksBlockedOnWrite);
+    POINTERS_EQUAL(NULL, queue.tasksBlockedOnRead.head);
+    POINTERS_EQUAL(NULL, queue.tasksBlockedOnWrite.head);
 }
 
 /*
@@ -268,3 +269,208 @@ TEST(Queue, IsFull)
 
     CHECK_TRUE(QueueIsFull(&queue));
 }
+
+/*
+ * Elements of every size are copied intact, including through buffers that aren't word aligned
+ */
+TEST(Queue, ElementSizes)
+{
+    const uintd_t sizes[] = { 1, 2, 3, 4, 8, 12, 16, 21 };
+    uint8_t in[32];
+    uint8_t out[32];
+
+    for(uintd_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        uintd_t size = sizes[s];
+
+        InitQueue(&queue, (uint8_t*)data, size, (SIZE * sizeof(uint32_t)) / size);
+
+        // Offset the caller's buffers by one byte on every other pass
+        for(uintd_t offset = 0; offset < 2; offset++)
+        {
+            for(uintd_t i = 0; i < size; i++)
+            {
+                in[offset + i] = (uint8_t)(size + i);
+            }
+
+            memset(out, 0, sizeof(out));
+
+            CHECK_FALSE(Enqueue(&queue, in + offset));
+            CHECK_FALSE(Dequeue(&queue, out + offset));
+
+            MEMCMP_EQUAL(in + offset, out + offset, size);
+            LONGS_EQUAL(0, out[offset + size]);
+        }
+    }
+}
+
+/*
+ * A power of two sized queue wraps with a mask, and must keep order and positions the same as any other queue
+ */
+TEST(Queue, PowerOfTwoWrap)
+{
+    uint32_t insert = 100;
+    uint32_t dequeue = 0;
+
+    InitQueue(&queue, (uint8_t*)data, sizeof(uint32_t), 8);
+
+    CHECK(queue.pow2Size);
+    CHECK(queue.pow2SizeOf);
+    LONGS_EQUAL(7, queue.mask);
+    LONGS_EQUAL(2, queue.shift);
+
+    // Go around the ring a few times, leaving 5 elements in it
+    for(int i = 0; i < 5; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&insert);
+        insert++;
+    }
+
+    for(int i = 0; i < 20; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&insert);
+        insert++;
+
+        Dequeue(&queue, (uint8_t*)&dequeue);
+        LONGS_EQUAL(100 + i, dequeue);
+    }
+
+    // 25 enqueued and 20 dequeued, so the front is at 20 % 8
+    CheckFrontAndCount(4, 5);
+    CheckDataAt(4, 120);
+    CheckDataAt(0, 124);
+}
+
+/*
+ * Queues that aren't a power of two in either dimension don't use mask or shift indexing
+ */
+TEST(Queue, NonPowerOfTwo)
+{
+    uint8_t in[3] = { 1, 2, 3 };
+
+    InitQueue(&queue, (uint8_t*)data, 3, 6);
+
+    CHECK_FALSE(queue.pow2Size);
+    CHECK_FALSE(queue.pow2SizeOf);
+
+    for(int i = 0; i < 7; i++)
+    {
+        Enqueue(&queue, in);
+        Dequeue(&queue, in);
+    }
+
+    CheckFrontAndCount(1, 0);
+
+    Enqueue(&queue, in);
+    MEMCMP_EQUAL(in, (uint8_t*)data + 3, 3);
+}
+
+/*
+ * Write an element in place with QueueReserve and QueueCommit
+ */
+TEST(Queue, ReserveCommit)
+{
+    uint32_t insert = 0xFEEDBEEF;
+    uint32_t dequeue = 0;
+    uint32_t* slot = (uint32_t*)QueueReserve(&queue);
+
+    POINTERS_EQUAL(&data[0], slot);
+
+    // Nothing else can go in until the reserved element is committed, and it can't be read yet either
+    POINTERS_EQUAL(NULL, QueueReserve(&queue));
+    CHECK_TRUE(Enqueue(&queue, (uint8_t*)&insert));
+    CHECK_TRUE(Dequeue(&queue, (uint8_t*)&dequeue));
+    CheckFrontAndCount(0, 0);
+
+    *slot = 0xDEADBEEF;
+    QueueCommit(&queue);
+
+    CheckFrontAndCount(0, 1);
+    CHECK_FALSE(Enqueue(&queue, (uint8_t*)&insert));
+    CHECK_FALSE(Dequeue(&queue, (uint8_t*)&dequeue));
+    LONGS_EQUAL(0xDEADBEEF, dequeue);
+}
+
+/*
+ * Nothing can be reserved in a full queue
+ */
+TEST(Queue, ReserveFull)
+{
+    uint32_t val = 0xDEADBEEF;
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        Enqueue(&queue, (uint8_t*)&val);
+    }
+
+    POINTERS_EQUAL(NULL, QueueReserve(&queue));
+    CHECK_FALSE(queue.reserved);
+}
+
+/*
+ * Read an element in place with QueuePeekAcquire and QueueRelease
+ */
+TEST(Queue, PeekAcquireRelease)
+{
+    uint32_t insert = 100;
+    uint32_t dequeue = 0;
+
+    POINTERS_EQUAL(NULL, QueuePeekAcquire(&queue));
+
+    Enqueue(&queue, (uint8_t*)&insert);
+    insert++;
+    Enqueue(&queue, (uint8_t*)&insert);
+
+    uint32_t* element = (uint32_t*)QueuePeekAcquire(&queue);
+
+    POINTERS_EQUAL(&data[0], element);
+    LONGS_EQUAL(100, *element);
+
+    // The acquired element holds the front of the queue
+    POINTERS_EQUAL(NULL, QueuePeekAcquire(&queue));
+    CHECK_TRUE(Dequeue(&queue, (uint8_t*)&dequeue));
+    CheckFrontAndCount(0, 2);
+
+    QueueRelease(&queue);
+
+    CheckFrontAndCount(1, 1);
+    CHECK_FALSE(Dequeue(&queue, (uint8_t*)&dequeue));
+    LONGS_EQUAL(101, dequeue);
+}
+
+/*
+ * Batches that wrap around the end of the storage are split and kept in order
+ */
+TEST(Queue, EnqueueDequeueMany)
+{
+    uint32_t in[SIZE];
+    uint32_t out[SIZE];
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        in[i] = 100 + i;
+    }
+
+    // Move the front along so the next batch has to wrap
+    LONGS_EQUAL(20, EnqueueMany(&queue, (uint8_t*)in, 20));
+    LONGS_EQUAL(20, DequeueMany(&queue, (uint8_t*)out, 20));
+    CheckFrontAndCount(20, 0);
+    LONGS_EQUAL(119, out[19]);
+
+    // Only SIZE fit, the rest are left behind
+    LONGS_EQUAL(SIZE, EnqueueMany(&queue, (uint8_t*)in, SIZE));
+    LONGS_EQUAL(0, EnqueueMany(&queue, (uint8_t*)in, 1));
+    CheckFrontAndCount(20, SIZE);
+    CheckDataAt(20, 100);
+    CheckDataAt(24, 104);
+    CheckDataAt(0, 105);
+
+    memset(out, 0, sizeof(out));
+    LONGS_EQUAL(SIZE, DequeueMany(&queue, (uint8_t*)out, SIZE + 5));
+    CheckFrontAndCount(20, 0);
+
+    for(int i = 0; i < SIZE; i++)
+    {
+        LONGS_EQUAL(100 + i, out[i]);
+    }
+}
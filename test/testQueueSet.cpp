@@ -0,0 +1,196 @@
+// 2015 Adam Jesionowski
+
+#include "CppUTest/TestHarness.h"
+#include "queueSet.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "utils.h"
+
+#define SET_SIZE   8
+#define QUEUE_SIZE 3
+
+TEST_GROUP(QueueSet)
+{
+    QueueSet_t set;
+    void*      setStorage[SET_SIZE];
+    Queue_t    queueA;
+    Queue_t    queueB;
+    uint32_t   storageA[QUEUE_SIZE];
+    uint32_t   storageB[QUEUE_SIZE];
+    Event_t    event;
+    Task_t     task;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        InitQueueSet(&set, setStorage, SET_SIZE);
+        InitQueue(&queueA, (uint8_t*)storageA, sizeof(uint32_t), QUEUE_SIZE);
+        InitQueue(&queueB, (uint8_t*)storageB, sizeof(uint32_t), QUEUE_SIZE);
+        InitEvent(&event);
+
+        QueueSetAddQueue(&set, &queueA);
+        QueueSetAddQueue(&set, &queueB);
+        QueueSetAddEvent(&set, &event);
+
+        RunTask(&task, PRIORITY_1);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * Members that are already readable are returned in the order they became readable, once for each element
+ */
+TEST(QueueSet, AlreadyReadable)
+{
+    uint32_t value = 1;
+    uint32_t out;
+
+    Enqueue(&queueB, (uint8_t*)&value);
+    TriggerEvent(&event);
+    Enqueue(&queueA, (uint8_t*)&value);
+    Enqueue(&queueB, (uint8_t*)&value);
+
+    POINTERS_EQUAL(&queueB, WaitAny(&set));
+    CHECK_FALSE(Dequeue(&queueB, (uint8_t*)&out));
+    POINTERS_EQUAL(&event, WaitAny(&set));
+    POINTERS_EQUAL(&queueA, WaitAny(&set));
+    CHECK_FALSE(Dequeue(&queueA, (uint8_t*)&out));
+    POINTERS_EQUAL(&queueB, WaitAny(&set));
+    CHECK_FALSE(Dequeue(&queueB, (uint8_t*)&out));
+
+    CHECK_TRUE(QueueIsEmpty(&set.ready));
+    POINTERS_EQUAL(&task, GetCurrentTask());
+}
+
+/*
+ * Waiting on an empty set blocks the task, and an enqueue to any member readies it
+ */
+TEST(QueueSet, WaitThenEnqueue)
+{
+    uint32_t value = 7;
+    uint32_t out = 0;
+
+    POINTERS_EQUAL(NULL, WaitAny(&set));
+    POINTERS_EQUAL(&idleTask, GetCurrentTask());
+    POINTERS_EQUAL(&task.taskList, set.ready.tasksBlockedOnRead.head);
+
+    Enqueue(&queueB, (uint8_t*)&value);
+    CHECK_TRUE(set.ready.tasksBlockedOnRead.head == NULL);
+
+    Tick();
+    POINTERS_EQUAL(&task, GetCurrentTask());
+
+    // The element stays in the member queue, the set only says where to look
+    LONGS_EQUAL(1, queueB.count);
+    POINTERS_EQUAL(&queueB, WaitAny(&set));
+    CHECK_FALSE(Dequeue(&queueB, (uint8_t*)&out));
+    LONGS_EQUAL(7, out);
+}
+
+/*
+ * Triggering a member event readies a task waiting on the set
+ */
+TEST(QueueSet, WaitThenTrigger)
+{
+    WaitAny(&set);
+    POINTERS_EQUAL(&idleTask, GetCurrentTask());
+
+    TriggerEvent(&event);
+
+    Tick();
+    POINTERS_EQUAL(&task, GetCurrentTask());
+    POINTERS_EQUAL(&event, WaitAny(&set));
+}
+
+/*
+ * Batch enqueues and commits to a member add an entry for each element
+ */
+TEST(QueueSet, BatchAndCommit)
+{
+    uint32_t values[2] = { 1, 2 };
+
+    LONGS_EQUAL(2, EnqueueMany(&queueA, (uint8_t*)values, 2));
+
+    *(uint32_t*)QueueReserve(&queueB) = 3;
+    LONGS_EQUAL(2, set.ready.count);
+    QueueCommit(&queueB);
+
+    LONGS_EQUAL(3, set.ready.count);
+    POINTERS_EQUAL(&queueA, WaitAny(&set));
+    POINTERS_EQUAL(&queueA, WaitAny(&set));
+    POINTERS_EQUAL(&queueB, WaitAny(&set));
+}
+
+/*
+ * A writer blocked on a full member has its element added to the set once a dequeue makes room for it
+ */
+TEST(QueueSet, BlockedWriter)
+{
+    Task_t   writer;
+    uint32_t value = 1;
+    uint32_t out;
+    int      i;
+
+    for(i = 0; i < QUEUE_SIZE; i++)
+    {
+        Enqueue(&queueA, (uint8_t*)&value);
+    }
+
+    RunTask(&writer, PRIORITY_2);
+
+    EnqueueBlocking(&queueA, (uint8_t*)&value);
+    POINTERS_EQUAL(&task, GetCurrentTask());
+    LONGS_EQUAL(QUEUE_SIZE, set.ready.count);
+
+    POINTERS_EQUAL(&queueA, WaitAny(&set));
+    CHECK_FALSE(Dequeue(&queueA, (uint8_t*)&out));
+
+    LONGS_EQUAL(QUEUE_SIZE, queueA.count);
+    LONGS_EQUAL(QUEUE_SIZE, set.ready.count);
+}
+
+/*
+ * A queue that already holds elements when it's added puts them in the set
+ */
+TEST(QueueSet, AddNonEmptyQueue)
+{
+    Queue_t  queueC;
+    uint32_t storageC[QUEUE_SIZE];
+    uint32_t value = 1;
+
+    InitQueue(&queueC, (uint8_t*)storageC, sizeof(uint32_t), QUEUE_SIZE);
+    Enqueue(&queueC, (uint8_t*)&value);
+    Enqueue(&queueC, (uint8_t*)&value);
+
+    QueueSetAddQueue(&set, &queueC);
+
+    LONGS_EQUAL(2, set.ready.count);
+    POINTERS_EQUAL(&queueC, WaitAny(&set));
+    POINTERS_EQUAL(&queueC, WaitAny(&set));
+}
+
+/*
+ * Queues and events outside of any set are unaffected
+ */
+TEST(QueueSet, NotInSet)
+{
+    Queue_t  queueC;
+    uint32_t storageC[QUEUE_SIZE];
+    uint32_t value = 1;
+    Event_t  other;
+
+    InitQueue(&queueC, (uint8_t*)storageC, sizeof(uint32_t), QUEUE_SIZE);
+    InitEvent(&other);
+
+    Enqueue(&queueC, (uint8_t*)&value);
+    TriggerEvent(&other);
+
+    CHECK_TRUE(QueueIsEmpty(&set.ready));
+}
@@ -10,8 +10,11 @@
 
 // These are declared in rtos.c.
 extern Task_t* CurrentTask;
-extern List_t* SleepingTasks;
-extern List_t* ReadyTasks[ NUM_PRIORITY_LEVELS ];
+extern ListHead_t SleepingTasks;
+extern ListHead_t ReadyTasks[ NUM_PRIORITY_LEVELS ];
+extern uintd_t ReadyGroups;
+extern uintd_t ReadyPriorities[];
+extern volatile uint64_t TickCount;
 
 TEST_GROUP(RTOS)
 {
@@ -27,7 +30,7 @@ TEST_GROUP(RTOS)
 
     Task_t* makeTask(uint8_t prio)
     {
-        Task_t* task = (Task_t*)malloc(sizeof(Task_t));
+        Task_t* task = (Task_t*)calloc(1, sizeof(Task_t));
 
         task->taskList.next  = NULL;
         task->taskList.owner = task;
@@ -35,6 +38,7 @@ TEST_GROUP(RTOS)
 
         task->sleepTimer = 0;
         task->priority   = prio;
+        task->waitData   = NULL;
 
         return task;
     }
@@ -48,7 +52,7 @@ TEST_GROUP(RTOS)
     {
         if(expected == NULL)
         {
-            POINTERS_EQUAL(expected, SleepingTasks);
+            POINTERS_EQUAL(expected, SleepingTasks.head);
         }
         else
         {
@@ -61,11 +65,11 @@ TEST_GROUP(RTOS)
     {
         if(expected == NULL)
         {
-            POINTERS_EQUAL(expected, ReadyTasks[priority]);
+            POINTERS_EQUAL(expected, ReadyTasks[priority].head);
         }
         else
         {
-            POINTERS_EQUAL(&expected->taskList, ReadyTasks[priority]);
+            POINTERS_EQUAL(&expected->taskList, ReadyTasks[priority].head);
         }
     }
 
@@ -80,7 +84,7 @@ TEST(RTOS, Initialized)
 
     for(i = 0; i < NUM_PRIORITY_LEVELS; i++)
     {
-        POINTERS_EQUAL(NULL, ReadyTasks[i]);
+        POINTERS_EQUAL(NULL, ReadyTasks[i].head);
     }
 
     CheckCurrentTask(&idleTask);
@@ -93,7 +97,7 @@ TEST(RTOS, StartSingleTask)
 {
     Task_t* task = makeTask(PRIORITY_1);
 
-    POINTERS_EQUAL(NULL, ReadyTasks[PRIORITY_1]);
+    POINTERS_EQUAL(NULL, ReadyTasks[PRIORITY_1].head);
 
     StartTask(task);
 
@@ -203,7 +207,8 @@ TEST(RTOS, StartTwoTasksSamePrio)
     StartTask(task2);
 
     CheckReadyTaskFront(task2, PRIORITY_1);
-    POINTERS_EQUAL(ReadyTasks[PRIORITY_1]->next, &task1->taskList);
+    POINTERS_EQUAL(ReadyTasks[PRIORITY_1].head->next, &task1->taskList);
+    POINTERS_EQUAL(ReadyTasks[PRIORITY_1].tail, &task1->taskList);
 
     CheckCurrentTask(&idleTask);
     CheckSleepingTasks(NULL);
@@ -322,7 +327,7 @@ TEST(RTOS, TimeSlicing)
  */
 TEST(RTOS, BlockCurrentTaskToList)
 {
-    List_t* list = NULL;
+    ListHead_t list = {NULL, NULL};
 
     Task_t* task1 = makeTask(PRIORITY_1);
     StartTask(task1);
@@ -333,7 +338,7 @@ TEST(RTOS, BlockCurrentTaskToList)
     BlockCurrentTaskToList(&list);
 
     CheckCurrentTask(&idleTask);
-    POINTERS_EQUAL(&task1->taskList, list);
+    POINTERS_EQUAL(&task1->taskList, list.head);
 }
 
 /*
@@ -341,7 +346,7 @@ TEST(RTOS, BlockCurrentTaskToList)
  */
 TEST(RTOS, ReadyTaskEntireList)
 {
-    List_t* list = NULL;
+    ListHead_t list = {NULL, NULL};
 
     Task_t* task1 = makeTask(PRIORITY_1);
     Task_t* task2 = makeTask(PRIORITY_2);
@@ -351,19 +356,19 @@ TEST(RTOS, ReadyTaskEntireList)
     Tick();
     BlockCurrentTaskToList(&list);
 
-    POINTERS_EQUAL(&task1->taskList, list);
+    POINTERS_EQUAL(&task1->taskList, list.head);
 
     StartTask(task2);
     Tick();
     BlockCurrentTaskToList(&list);
 
-    POINTERS_EQUAL(&task2->taskList, list);
+    POINTERS_EQUAL(&task2->taskList, list.head);
 
     StartTask(task3);
     Tick();
     BlockCurrentTaskToList(&list);
 
-    POINTERS_EQUAL(&task3->taskList, list);
+    POINTERS_EQUAL(&task3->taskList, list.head);
     POINTERS_EQUAL(&task2->taskList, task3->taskList.next);
 
     CheckReadyTaskFront(NULL, PRIORITY_1);
@@ -376,3 +381,452 @@ TEST(RTOS, ReadyTaskEntireList)
     CheckReadyTaskFront(task2, PRIORITY_2);
     CheckReadyTaskFront(task3, PRIORITY_3);
 }
+
+/*
+ * Check that the ready bitmap follows tasks onto and off of the ready lists
+ */
+TEST(RTOS, ReadyBitmap)
+{
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_5);
+
+    LONGS_EQUAL(0, ReadyGroups);
+    LONGS_EQUAL(0, ReadyPriorities[0]);
+
+    StartTask(task1);
+    StartTask(task2);
+
+    LONGS_EQUAL(1, ReadyGroups);
+    LONGS_EQUAL((1 << PRIORITY_1) | (1 << PRIORITY_5), ReadyPriorities[0]);
+
+    // task2 takes over, the idle task goes to the end of its (previously empty) list
+    Tick();
+
+    CheckCurrentTask(task2);
+    LONGS_EQUAL((1 << PRIORITY_0) | (1 << PRIORITY_1), ReadyPriorities[0]);
+
+    // Sleeping task2 should switch to task1, clearing its bit
+    DelayCurrentTask(1);
+
+    CheckCurrentTask(task1);
+    LONGS_EQUAL((1 << PRIORITY_0), ReadyPriorities[0]);
+}
+
+/*
+ * Check that the highest priority ready task is picked when a task blocks, no matter the order tasks were started in
+ */
+TEST(RTOS, SwitchPicksHighestPriority)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_3);
+    Task_t* task2 = makeTask(PRIORITY_6);
+    Task_t* task3 = makeTask(PRIORITY_2);
+
+    StartTask(task1);
+    StartTask(task2);
+    StartTask(task3);
+    Tick();
+
+    CheckCurrentTask(task2);
+
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(task1);
+
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(task3);
+
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(&idleTask);
+    LONGS_EQUAL(0, ReadyGroups);
+}
+
+/*
+ * Sleep three tasks out of order, they should be sorted by wake time with relative sleep timers
+ */
+TEST(RTOS, SleepingTasksSorted)
+{
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_1);
+    Task_t* task3 = makeTask(PRIORITY_1);
+
+    StartTask(task1);
+    StartTask(task2);
+    StartTask(task3);
+    Tick();
+
+    // Each delay switches to the next task at the front of the ready list
+    CheckCurrentTask(task3);
+    DelayCurrentTask(5);
+    CheckCurrentTask(task2);
+    DelayCurrentTask(2);
+    CheckCurrentTask(task1);
+    DelayCurrentTask(3);
+
+    // task2 (2) -> task1 (3) -> task3 (5)
+    POINTERS_EQUAL(&task2->taskList, SleepingTasks.head);
+    POINTERS_EQUAL(&task1->taskList, task2->taskList.next);
+    POINTERS_EQUAL(&task3->taskList, task1->taskList.next);
+    POINTERS_EQUAL(&task3->taskList, SleepingTasks.tail);
+
+    LONGS_EQUAL(2, task2->sleepTimer);
+    LONGS_EQUAL(1, task1->sleepTimer);
+    LONGS_EQUAL(2, task3->sleepTimer);
+}
+
+/*
+ * Tasks should wake in order, each on the same tick they would have if they were the only one sleeping
+ */
+TEST(RTOS, SleepingTasksWakeInOrder)
+{
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_2);
+
+    StartTask(task1);
+    StartTask(task2);
+    Tick();
+
+    CheckCurrentTask(task2);
+    DelayCurrentTask(1);
+    CheckCurrentTask(task1);
+    DelayCurrentTask(3);
+    CheckCurrentTask(&idleTask);
+
+    // A delay of 1 wakes on the second tick
+    Tick();
+    CheckCurrentTask(&idleTask);
+    Tick();
+    CheckCurrentTask(task2);
+    CheckSleepingTasks(task1);
+
+    // And a delay of 3 on the fourth
+    Tick();
+    CheckReadyTaskFront(NULL, PRIORITY_1);
+    Tick();
+    CheckReadyTaskFront(task1, PRIORITY_1);
+    CheckSleepingTasks(NULL);
+}
+
+/*
+ * Tasks sleeping for the same time wake on the same tick
+ */
+TEST(RTOS, SleepingTasksSameTime)
+{
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_1);
+
+    StartTask(task1);
+    StartTask(task2);
+    Tick();
+
+    CheckCurrentTask(task2);
+    DelayCurrentTask(2);
+    CheckCurrentTask(task1);
+    DelayCurrentTask(2);
+
+    POINTERS_EQUAL(&task2->taskList, SleepingTasks.head);
+    LONGS_EQUAL(0, task1->sleepTimer);
+
+    Tick();
+    Tick();
+    CheckCurrentTask(&idleTask);
+    Tick();
+
+    CheckSleepingTasks(NULL);
+    CheckCurrentTask(task1);
+    CheckReadyTaskFront(task2, PRIORITY_1);
+}
+
+/*
+ * Tasks blocked to a list are kept highest priority first, and in blocking order within a priority
+ */
+TEST(RTOS, BlockedListPriorityOrder)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_3);
+    Task_t* task3 = makeTask(PRIORITY_2);
+    Task_t* task4 = makeTask(PRIORITY_3);
+
+    StartTask(task1);
+    StartTask(task2);
+    StartTask(task3);
+    StartTask(task4);
+    Tick();
+
+    // Block every task in the order they're switched to: task4, task2, task3, task1
+    CheckCurrentTask(task4);
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(task2);
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(task3);
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(task1);
+    BlockCurrentTaskToList(&list);
+
+    POINTERS_EQUAL(&task4->taskList, list.head);
+    POINTERS_EQUAL(&task2->taskList, task4->taskList.next);
+    POINTERS_EQUAL(&task3->taskList, task2->taskList.next);
+    POINTERS_EQUAL(&task1->taskList, task3->taskList.next);
+    POINTERS_EQUAL(&task1->taskList, list.tail);
+}
+
+/*
+ * Only the highest priority task on a list is readied
+ */
+TEST(RTOS, ReadyHighestPriorityTask)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_2);
+
+    StartTask(task1);
+    StartTask(task2);
+    Tick();
+
+    BlockCurrentTaskToList(&list);
+    BlockCurrentTaskToList(&list);
+    CheckCurrentTask(&idleTask);
+
+    POINTERS_EQUAL(task2, ReadyHighestPriorityTask(&list));
+    CheckReadyTaskFront(task2, PRIORITY_2);
+    POINTERS_EQUAL(&task1->taskList, list.head);
+    POINTERS_EQUAL(NULL, ReadyTasks[PRIORITY_1].head);
+
+    POINTERS_EQUAL(task1, ReadyHighestPriorityTask(&list));
+    POINTERS_EQUAL(NULL, list.head);
+    POINTERS_EQUAL(NULL, ReadyHighestPriorityTask(&list));
+}
+
+/*
+ * A task that isn't unblocked before its timeout comes off the blocked list by itself
+ */
+TEST(RTOS, BlockTimeoutExpires)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_1);
+
+    StartTask(task1);
+    Tick();
+
+    BlockCurrentTaskToListTimeout(&list, 2);
+
+    CheckCurrentTask(&idleTask);
+    POINTERS_EQUAL(&task1->taskList, list.head);
+    POINTERS_EQUAL(&task1->timeoutList, SleepingTasks.head);
+    CHECK_FALSE(task1->timedOut);
+
+    Tick();
+    Tick();
+    CheckCurrentTask(&idleTask);
+    Tick();
+
+    CheckCurrentTask(task1);
+    CHECK_TRUE(task1->timedOut);
+    POINTERS_EQUAL(NULL, list.head);
+    CheckSleepingTasks(NULL);
+    POINTERS_EQUAL(NULL, task1->blockedOn);
+}
+
+/*
+ * A task unblocked before its timeout has the timeout taken off SleepingTasks, and the task sleeping
+ * behind it still wakes on time
+ */
+TEST(RTOS, BlockTimeoutCancelled)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_2);
+
+    StartTask(task1);
+    StartTask(task2);
+    Tick();
+
+    // task2 blocks with 2 ticks to go, task1 sleeps for 5, 3 after task2's timeout
+    BlockCurrentTaskToListTimeout(&list, 2);
+    CheckCurrentTask(task1);
+    DelayCurrentTask(5);
+
+    LONGS_EQUAL(3, task1->sleepTimer);
+
+    POINTERS_EQUAL(task2, ReadyHighestPriorityTask(&list));
+
+    CHECK_FALSE(task2->timedOut);
+    POINTERS_EQUAL(NULL, task2->blockedOn);
+    POINTERS_EQUAL(&task1->taskList, SleepingTasks.head);
+    LONGS_EQUAL(5, task1->sleepTimer);
+}
+
+/*
+ * A timeout of MAX_DELAY_TICKS waits forever, without going on SleepingTasks
+ */
+TEST(RTOS, BlockTimeoutForever)
+{
+    ListHead_t list = {NULL, NULL};
+
+    Task_t* task1 = makeTask(PRIORITY_1);
+
+    StartTask(task1);
+    Tick();
+
+    BlockCurrentTaskToListTimeout(&list, MAX_DELAY_TICKS);
+
+    POINTERS_EQUAL(&task1->taskList, list.head);
+    CheckSleepingTasks(NULL);
+    CHECK_FALSE(task1->timeoutRunning);
+    POINTERS_EQUAL(&list, task1->blockedOn);
+}
+
+/*
+ * Delay a task until an absolute tick, then tick until it wakes on that tick.
+ */
+TEST(RTOS, DelayUntil)
+{
+    Task_t* task = makeTask(PRIORITY_1);
+
+    StartTask(task);
+    Tick();
+
+    CHECK_FALSE(DelayCurrentTaskUntil(4));
+    LONGS_EQUAL(2, task->sleepTimer);
+    CheckCurrentTask(&idleTask);
+
+    Tick();
+    Tick();
+    CheckCurrentTask(&idleTask);
+
+    Tick();
+    LONGS_EQUAL(4, GetTickCount64());
+    CheckCurrentTask(task);
+    CheckSleepingTasks(NULL);
+}
+
+/*
+ * Delaying until a tick that has already happened doesn't sleep.
+ */
+TEST(RTOS, DelayUntilPassed)
+{
+    Task_t* task = makeTask(PRIORITY_1);
+
+    StartTask(task);
+    Tick();
+    Tick();
+
+    CHECK_TRUE(DelayCurrentTaskUntil(1));
+    CHECK_TRUE(DelayCurrentTaskUntil(2));
+
+    CheckCurrentTask(task);
+    CheckSleepingTasks(NULL);
+}
+
+/*
+ * The 64-bit tick count carries on past where GetTickCount wraps around.
+ */
+TEST(RTOS, TickCount64)
+{
+    TickCount = 0xFFFFFFFF;
+
+    Tick();
+
+    LONGS_EQUAL(0, GetTickCount());
+    CHECK(GetTickCount64() == 0x100000000ULL);
+
+    // A delay until past the wrap is still the right number of ticks
+    StartTask(makeTask(PRIORITY_1));
+    Tick();
+
+    CHECK_FALSE(DelayCurrentTaskUntil(0x100000000ULL + 10));
+    LONGS_EQUAL(8, ((Task_t*)SleepingTasks.head->owner)->sleepTimer);
+}
+
+/*
+ * A periodic task wakes every period ticks, however long it worked for in between.
+ */
+TEST(RTOS, DelayUntilPeriodic)
+{
+    Task_t* task = makeTask(PRIORITY_1);
+    uint64_t lastWake;
+
+    StartTask(task);
+    Tick();
+
+    lastWake = GetTickCount64();
+
+    // Work for one tick
+    Tick();
+
+    CHECK_FALSE(DelayUntil(&lastWake, 3));
+    LONGS_EQUAL(4, lastWake);
+
+    Tick();
+    Tick();
+    CheckCurrentTask(task);
+    LONGS_EQUAL(4, GetTickCount64());
+
+    // Work for two ticks, the next wake is still a period after the last
+    Tick();
+    Tick();
+
+    CHECK_FALSE(DelayUntil(&lastWake, 3));
+    LONGS_EQUAL(7, lastWake);
+
+    Tick();
+    CheckCurrentTask(task);
+    LONGS_EQUAL(7, GetTickCount64());
+}
+
+/*
+ * A periodic task that works past its next wake is told it overran, and doesn't sleep.
+ */
+TEST(RTOS, DelayUntilOverrun)
+{
+    Task_t* task = makeTask(PRIORITY_1);
+    uint64_t lastWake;
+
+    StartTask(task);
+    Tick();
+
+    lastWake = GetTickCount64();
+
+    // Work for three ticks, past the wake at 3
+    Tick();
+    Tick();
+    Tick();
+
+    CHECK_TRUE(DelayUntil(&lastWake, 2));
+    CheckCurrentTask(task);
+    CheckSleepingTasks(NULL);
+
+    // Catching up keeps the phase, the next wake is at 5
+    CHECK_FALSE(DelayUntil(&lastWake, 2));
+    LONGS_EQUAL(5, lastWake);
+    LONGS_EQUAL(0, task->sleepTimer);
+}
+
+/*
+ * Changing a ready task's priority moves it to the new ready list, a sleeping task's lists are left alone
+ */
+TEST(RTOS, SetTaskPriority)
+{
+    Task_t* task1 = makeTask(PRIORITY_1);
+    Task_t* task2 = makeTask(PRIORITY_1);
+
+    StartTask(task1);
+    Tick();
+    DelayCurrentTask(5);
+
+    StartTask(task2);
+
+    SetTaskPriority(task1, PRIORITY_3);
+    LONGS_EQUAL(PRIORITY_3, task1->priority);
+    CheckReadyTaskFront(NULL, PRIORITY_3);
+    CheckSleepingTasks(task1);
+
+    SetTaskPriority(task2, PRIORITY_2);
+    CheckReadyTaskFront(NULL, PRIORITY_1);
+    CheckReadyTaskFront(task2, PRIORITY_2);
+}
@@ -0,0 +1,167 @@
+// 2015 Adam Jesionowski
+
+#include <pthread.h>
+#include <sched.h>
+#include "CppUTest/TestHarness.h"
+#include "ring.h"
+#include "rtos.h"
+#include "idleTask.h"
+
+#define SIZE 8
+#define STRESS_COUNT 1000000
+
+TEST_GROUP(Ring)
+{
+    Ring_t   ring;
+    uint32_t data[SIZE];
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        CHECK_FALSE(InitRing(&ring, (uint8_t*)data, sizeof(uint32_t), SIZE));
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * Only power of two sizes are allowed
+ */
+TEST(Ring, InitSize)
+{
+    CHECK_TRUE(InitRing(&ring, (uint8_t*)data, sizeof(uint32_t), 6));
+    CHECK_TRUE(InitRing(&ring, (uint8_t*)data, sizeof(uint32_t), 0));
+    CHECK_FALSE(InitRing(&ring, (uint8_t*)data, sizeof(uint32_t), 1));
+}
+
+/*
+ * Fill the ring, then drain it, going around more than once
+ */
+TEST(Ring, PutGet)
+{
+    uint32_t insert = 100;
+    uint32_t val = 0;
+
+    CHECK_TRUE(RingGet(&ring, (uint8_t*)&val));
+
+    for(int pass = 0; pass < 3; pass++)
+    {
+        for(int i = 0; i < SIZE; i++)
+        {
+            CHECK_FALSE(RingPut(&ring, (uint8_t*)&insert));
+            insert++;
+        }
+
+        CHECK_TRUE(RingPut(&ring, (uint8_t*)&insert));
+        LONGS_EQUAL(SIZE, RingCount(&ring));
+
+        for(int i = 0; i < SIZE; i++)
+        {
+            CHECK_FALSE(RingGet(&ring, (uint8_t*)&val));
+            LONGS_EQUAL(100 + (pass * SIZE) + i, val);
+        }
+
+        CHECK_TRUE(RingGet(&ring, (uint8_t*)&val));
+        LONGS_EQUAL(0, RingCount(&ring));
+    }
+}
+
+/*
+ * The consumer blocks on an empty ring, and the next put readies it
+ */
+TEST(Ring, GetBlocking)
+{
+    uint32_t insert = 0xDEADBEEF;
+    uint32_t val = 0;
+
+    RingGetBlocking(&ring, (uint8_t*)&val);
+
+    POINTERS_EQUAL(&idleTask.taskList, ring.blockedTasks.head);
+    CHECK_TRUE(ring.consumerWaiting);
+
+    RingPut(&ring, (uint8_t*)&insert);
+
+    POINTERS_EQUAL(NULL, ring.blockedTasks.head);
+    CHECK_FALSE(ring.consumerWaiting);
+
+    RingGetBlocking(&ring, (uint8_t*)&val);
+    LONGS_EQUAL(0xDEADBEEF, val);
+}
+
+/*
+ * A put while the consumer isn't waiting doesn't touch the blocked list
+ */
+TEST(Ring, PutWithoutWaiter)
+{
+    uint32_t insert = 1;
+
+    RingPut(&ring, (uint8_t*)&insert);
+
+    POINTERS_EQUAL(NULL, ring.blockedTasks.head);
+    CHECK_FALSE(ring.consumerWaiting);
+}
+
+static void* StressProducer(void* arg)
+{
+    Ring_t*  ring = (Ring_t*)arg;
+    uint32_t i;
+
+    for(i = 0; i < STRESS_COUNT; i++)
+    {
+        while(RingPut(ring, (uint8_t*)&i))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void* StressConsumer(void* arg)
+{
+    Ring_t*   ring = (Ring_t*)arg;
+    uint32_t  i;
+    uint32_t  val;
+    uintptr_t errors = 0;
+
+    for(i = 0; i < STRESS_COUNT; i++)
+    {
+        while(RingGet(ring, (uint8_t*)&val))
+        {
+            sched_yield();
+        }
+
+        if(val != i)
+        {
+            errors++;
+        }
+    }
+
+    return (void*)errors;
+}
+
+/*
+ * Run a producer and a consumer on separate threads, checking every element arrives once and in order
+ */
+TEST(Ring, Stress)
+{
+    pthread_t producer;
+    pthread_t consumer;
+    void*     errors;
+
+    LONGS_EQUAL(0, pthread_create(&consumer, NULL, StressConsumer, &ring));
+    LONGS_EQUAL(0, pthread_create(&producer, NULL, StressProducer, &ring));
+
+    pthread_join(producer, NULL);
+    pthread_join(consumer, &errors);
+
+    POINTERS_EQUAL(NULL, errors);
+    LONGS_EQUAL(0, RingCount(&ring));
+    LONGS_EQUAL(STRESS_COUNT, ring.head);
+}
@@ -0,0 +1,161 @@
+// 2015 Adam Jesionowski
+
+#include <pthread.h>
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "semaphore.h"
+#include "rtos.h"
+#include "idleTask.h"
+#include "utils.h"
+
+#define STRESS_COUNT 1000000
+
+TEST_GROUP(Semaphore)
+{
+    Semaphore_t sem;
+    Task_t      low;
+    Task_t      high;
+
+    void setup()
+    {
+        RTOS_Initialize();
+        StartTask(&idleTask);
+        Tick();
+
+        InitSemaphore(&sem, 0);
+    }
+
+    void teardown()
+    {
+
+    }
+};
+
+/*
+ * Units are taken without blocking while there are some
+ */
+TEST(Semaphore, TakeAvailable)
+{
+    InitSemaphore(&sem, 2);
+    RunTask(&low, PRIORITY_1);
+
+    SemaphoreTake(&sem);
+    CHECK_FALSE(SemaphoreTryTake(&sem));
+    LONGS_EQUAL(0, sem.count);
+
+    CHECK_TRUE(SemaphoreTryTake(&sem));
+    LONGS_EQUAL(0, sem.count);
+
+    SemaphoreGive(&sem);
+    LONGS_EQUAL(1, sem.count);
+    POINTERS_EQUAL(&low, GetCurrentTask());
+}
+
+/*
+ * Taking with no units blocks, and a give hands its unit to the waiting task
+ */
+TEST(Semaphore, TakeBlocks)
+{
+    RunTask(&low, PRIORITY_1);
+
+    SemaphoreTake(&sem);
+
+    LONGS_EQUAL(-1, sem.count);
+    POINTERS_EQUAL(&low.taskList, sem.blockedTasks.head);
+    POINTERS_EQUAL(&idleTask, GetCurrentTask());
+
+    SemaphoreGive(&sem);
+
+    LONGS_EQUAL(0, sem.count);
+    POINTERS_EQUAL(NULL, sem.blockedTasks.head);
+
+    Tick();
+    POINTERS_EQUAL(&low, GetCurrentTask());
+}
+
+/*
+ * Each give wakes one waiter, highest priority first
+ */
+TEST(Semaphore, WakeInPriorityOrder)
+{
+    RunTask(&low, PRIORITY_1);
+    SemaphoreTake(&sem);
+
+    RunTask(&high, PRIORITY_3);
+    SemaphoreTake(&sem);
+
+    LONGS_EQUAL(-2, sem.count);
+    POINTERS_EQUAL(&high.taskList, sem.blockedTasks.head);
+
+    SemaphoreGive(&sem);
+    LONGS_EQUAL(-1, sem.count);
+    POINTERS_EQUAL(&low.taskList, sem.blockedTasks.head);
+
+    SemaphoreGive(&sem);
+    LONGS_EQUAL(0, sem.count);
+    POINTERS_EQUAL(NULL, sem.blockedTasks.head);
+
+    SemaphoreGive(&sem);
+    LONGS_EQUAL(1, sem.count);
+}
+
+/*
+ * An interrupt's give says whether it readied a task
+ */
+TEST(Semaphore, GiveFromISR)
+{
+    CHECK_FALSE(SemaphoreGiveFromISR(&sem));
+    LONGS_EQUAL(1, sem.count);
+
+    RunTask(&low, PRIORITY_1);
+    SemaphoreTake(&sem);
+    SemaphoreTake(&sem);
+
+    LONGS_EQUAL(-1, sem.count);
+
+    CHECK_TRUE(SemaphoreGiveFromISR(&sem));
+    SwitchToHighestPriorityTaskFromISR();
+
+    POINTERS_EQUAL(&low, GetCurrentTask());
+}
+
+static void* StressGiveTake(void* arg)
+{
+    Semaphore_t* sem = (Semaphore_t*)arg;
+    uintptr_t failed = 0;
+    uint32_t i;
+
+    for(i = 0; i < STRESS_COUNT; i++)
+    {
+        SemaphoreGive(sem);
+
+        if(SemaphoreTryTake(sem))
+        {
+            failed++;
+        }
+    }
+
+    return (void*)failed;
+}
+
+/*
+ * Two threads give and take at once without a critical section between them. Every give is followed by a
+ * take, so a take can only fail if a unit went missing.
+ */
+TEST(Semaphore, Stress)
+{
+    pthread_t a;
+    pthread_t b;
+    void*     failedA;
+    void*     failedB;
+
+    LONGS_EQUAL(0, pthread_create(&a, NULL, StressGiveTake, &sem));
+    LONGS_EQUAL(0, pthread_create(&b, NULL, StressGiveTake, &sem));
+
+    pthread_join(a, &failedA);
+    pthread_join(b, &failedB);
+
+    POINTERS_EQUAL(NULL, failedA);
+    POINTERS_EQUAL(NULL, failedB);
+    LONGS_EQUAL(0, sem.count);
+}
@@ -0,0 +1,177 @@
+// 2015 Adam Jesionowski
+
+#include <stdlib.h>
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "rtos.h"
+#include "timer.h"
+#include "task.h"
+#include "idleTask.h"
+#include "utils.h"
+
+// Declared in rtos.c
+extern Task_t* CurrentTask;
+
+// Simulated port hook, from test/port.c
+extern uintd_t ticksSuppressed;
+extern uintd_t ticksUntilInterrupt;
+
+// Fake hardware timer register
+extern TIME timerReg;
+
+// Variables from timer.c
+extern TIME timeTimerSet;
+extern Timer_t* nextTimer;
+
+static Timer_t timer;
+
+static void tickCallback(void* arg){}
+
+TEST_GROUP(Tickless)
+{
+    Task_t task;
+
+    void setup()
+    {
+        RTOS_Initialize();
+
+        ticksSuppressed     = 0;
+        ticksUntilInterrupt = MAX_DELAY_TICKS;
+
+        timerReg     = 0;
+        timeTimerSet = 0;
+        nextTimer    = NULL;
+        memset(&timer, 0, sizeof(timer));
+    }
+
+    void teardown()
+    {
+
+    }
+
+    // Run the task, then put it to sleep so only the idle task is left
+    void SleepTask(uintd_t ticks)
+    {
+        RunTask(&task, PRIORITY_1);
+        DelayCurrentTask(ticks);
+        POINTERS_EQUAL(&idleTask, CurrentTask);
+    }
+};
+
+/*
+ * With one task sleeping, the tick is suppressed until it needs to wake
+ */
+TEST(Tickless, SuppressUntilSleeperWakes)
+{
+    SleepTask(5);
+
+    uintd_t ticksBefore = GetTickCount();
+
+    TicklessIdle();
+
+    LONGS_EQUAL(5, ticksSuppressed);
+    LONGS_EQUAL(ticksBefore + 5, GetTickCount());
+    LONGS_EQUAL(0, task.sleepTimer);
+
+    // The next tick wakes the task, as it would have without tickless idle
+    Tick();
+    POINTERS_EQUAL(&task, CurrentTask);
+}
+
+/*
+ * Another interrupt wakes the processor before the full time has passed
+ */
+TEST(Tickless, WokenEarly)
+{
+    SleepTask(5);
+
+    ticksUntilInterrupt = 2;
+
+    TicklessIdle();
+
+    LONGS_EQUAL(5, ticksSuppressed);
+    LONGS_EQUAL(3, task.sleepTimer);
+}
+
+/*
+ * If another task is ready, the tick is needed and nothing is suppressed
+ */
+TEST(Tickless, NotIdleWithReadyTask)
+{
+    Task_t other;
+
+    memset(&other, 0, sizeof(other));
+    other.priority       = PRIORITY_1;
+    other.taskList.owner = &other;
+
+    SleepTask(5);
+    StartTask(&other);
+
+    TicklessIdle();
+
+    LONGS_EQUAL(0, ticksSuppressed);
+    LONGS_EQUAL(5, task.sleepTimer);
+}
+
+/*
+ * Short sleeps aren't worth stopping the tick for
+ */
+TEST(Tickless, TooShortToSuppress)
+{
+    SleepTask(TICKLESS_MIN_IDLE_TICKS - 1);
+
+    TicklessIdle();
+
+    LONGS_EQUAL(0, ticksSuppressed);
+}
+
+/*
+ * With nothing sleeping and no timers, the port is asked for the longest sleep possible
+ */
+TEST(Tickless, NothingToWakeFor)
+{
+    ticksUntilInterrupt = 10;
+
+    TicklessIdle();
+
+    LONGS_EQUAL(MAX_DELAY_TICKS, ticksSuppressed);
+    LONGS_EQUAL(10, GetTickCount());
+}
+
+/*
+ * A software timer due before the sleeping task limits how long the tick is suppressed
+ */
+TEST(Tickless, TimerDeadlineLimitsSleep)
+{
+    SleepTask(10);
+
+    TimerStart(&timer, 3 * TIMER_COUNTS_PER_TICK + TIMER_COUNTS_PER_TICK / 2, tickCallback, NULL, false);
+
+    TicklessIdle();
+
+    LONGS_EQUAL(3, ticksSuppressed);
+    LONGS_EQUAL(7, task.sleepTimer);
+}
+
+/*
+ * Advancing ticks wakes tasks exactly as calling UpdateSleeping once per tick would
+ */
+TEST(Tickless, AdvanceMatchesTicks)
+{
+    Task_t other;
+
+    RunTask(&task, PRIORITY_1);
+    RunTask(&other, PRIORITY_2);
+    DelayCurrentTask(2);
+    DelayCurrentTask(4);
+
+    // other (2) -> task (2)
+    AdvanceTicks(3);
+
+    LONGS_EQUAL(1, task.sleepTimer);
+    LONGS_EQUAL(5, GetTickCount());
+
+    // other was readied along the way, task is still asleep
+    Tick();
+    POINTERS_EQUAL(&other, CurrentTask);
+}
@@ -6,6 +6,7 @@
 #include "rtos.h"
 #include "config.h"
 #include <iostream>
+#include <string.h>
 
 // Fake hardware
 extern TIME hwTime;     // Fake hardware register compare
@@ -14,21 +15,22 @@ extern TIME timerReg;   // Fake hardware register count
 // Variables from timer.c
 extern TIME timeTimerSet;
 extern Timer_t* nextTimer;
-extern Timer_t timers[NUM_TIMERS];
+extern TIME64 clockHigh;
+extern TIME clockLast;
 
-// Convenience pointers to the first 3 timers.
-Timer_t* timer1 = NULL;
-Timer_t* timer2 = NULL;
-Timer_t* timer3 = NULL;
+// The timers under test, and pointers to them to keep the tests short.
+static Timer_t timerStorage[3];
+Timer_t* timer1 = &timerStorage[0];
+Timer_t* timer2 = &timerStorage[1];
+Timer_t* timer3 = &timerStorage[2];
 
 // These booleans indicate if a callback has succeeded.
 bool t1Cb = false;
 bool t2Cb = false;
 bool t3Cb = false;
 
-void timer1Callback(){ t1Cb = true; }
-void timer2Callback(){ t2Cb = true; }
-void timer3Callback(){ t3Cb = true; }
+// Every timer uses the same callback, with the flag to set as its argument
+void setFlagCallback(void* arg){ *(bool*)arg = true; }
 
 TEST_GROUP(Timer)
 {
@@ -36,23 +38,14 @@ TEST_GROUP(Timer)
     {
         RTOS_Initialize();
 
-        timer1 = &timers[0];
-        timer2 = &timers[1];
-        timer3 = &timers[2];
-
         timeTimerSet = 0;
         timerReg = 0;
         nextTimer = NULL;
         hwTime = 0;
+        clockHigh = 0;
+        clockLast = 0;
 
-        for(int i = 0; i < NUM_TIMERS; i++)
-        {
-            timers[i].isActive = false;
-            timers[i].timeLeft = 0;
-            timers[i].originalTime = 0;
-            timers[i].reload = false;
-            timers[i].callback = NULL;
-        }
+        memset(timerStorage, 0, sizeof(timerStorage));
 
         t1Cb = false;
         t2Cb = false;
@@ -100,10 +93,10 @@ TEST(Timer, StartHardwareTimer)
  */
 TEST(Timer, TimerEnableNoOtherTimer)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
 
     // Timer1 will be next timer, with 3 left on itself and the hardware compare.
-    LONGS_EQUAL(3, timer1->timeLeft);
+    LONGS_EQUAL(3, TimerTimeLeft(timer1));
     CHECK_TRUE(timer1->isActive);
     CHECK_FALSE(t1Cb);
 
@@ -116,11 +109,11 @@ TEST(Timer, TimerEnableNoOtherTimer)
  */
 TEST(Timer, TimerEnableSecondLonger)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 5, (timerCallback)&timer2Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 5, setFlagCallback, &t2Cb, false);
 
     // Timer1 will still be next timer, with 3 left on hardware compare.
-    LONGS_EQUAL(5, timer2->timeLeft);
+    LONGS_EQUAL(5, TimerTimeLeft(timer2));
     CHECK_TRUE(timer2->isActive);
     CHECK_FALSE(t2Cb);
 
@@ -133,8 +126,8 @@ TEST(Timer, TimerEnableSecondLonger)
  */
 TEST(Timer, TimerEnableSecondShorter)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 1, (timerCallback)&timer2Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 1, setFlagCallback, &t2Cb, false);
 
     // Now Timer2 will be next timer, with 1 left on hardware compare.
     CheckNextTimer(timer2);
@@ -146,12 +139,12 @@ TEST(Timer, TimerEnableSecondShorter)
  */
 TEST(Timer, TimerDisableNoOtherTimer)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
 
     CHECK_TRUE(timer1->isActive);
     CheckNextTimer(timer1);
 
-    TimerDisable(SWTimer1);
+    TimerStop(timer1);
 
     // There should be no next timer now.
     CHECK_FALSE(timer1->isActive);
@@ -163,13 +156,13 @@ TEST(Timer, TimerDisableNoOtherTimer)
  */
 TEST(Timer, TimerDisableShorter)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 5, (timerCallback)&timer2Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 5, setFlagCallback, &t2Cb, false);
 
     CHECK_TRUE(timer1->isActive);
     CheckNextTimer(timer1);
 
-    TimerDisable(SWTimer1);
+    TimerStop(timer1);
 
     // Now timer1 should be inactive, and timer2 should be next, with 5 left.
     CHECK_FALSE(timer1->isActive);
@@ -182,13 +175,13 @@ TEST(Timer, TimerDisableShorter)
  */
 TEST(Timer, TimerDisableLonger)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 1, (timerCallback)&timer2Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 1, setFlagCallback, &t2Cb, false);
 
     CHECK_TRUE(timer1->isActive);
     CheckNextTimer(timer2);
 
-    TimerDisable(SWTimer1);
+    TimerStop(timer1);
 
     // Again, timer1 should be inactive, and timer2 should be next, with 1 left.
     CHECK_FALSE(timer1->isActive);
@@ -201,24 +194,24 @@ TEST(Timer, TimerDisableLonger)
  */
 TEST(Timer, TimerUpdate)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 4, (timerCallback)&timer2Callback, false);
-    TimerEnable(SWTimer3, 7, (timerCallback)&timer3Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 4, setFlagCallback, &t2Cb, false);
+    TimerStart(timer3, 7, setFlagCallback, &t3Cb, false);
 
     // We set register to 5, so timers 1 and 2 should fire, but timer 3 should not.
     SetTimerCount(5);
 
     TimerUpdate();
 
-    LONGS_EQUAL(0, timer1->timeLeft);
+    LONGS_EQUAL(0, TimerTimeLeft(timer1));
     CHECK_FALSE(timer1->isActive);
     CHECK_TRUE(t1Cb);
 
-    LONGS_EQUAL(0, timer2->timeLeft);
+    LONGS_EQUAL(0, TimerTimeLeft(timer2));
     CHECK_FALSE(timer2->isActive);
     CHECK_TRUE(t2Cb);
 
-    LONGS_EQUAL(2, timer3->timeLeft);
+    LONGS_EQUAL(2, TimerTimeLeft(timer3));
     CHECK_TRUE(timer3->isActive);
     CHECK_FALSE(t3Cb);
 
@@ -230,23 +223,23 @@ TEST(Timer, TimerUpdate)
  */
 TEST(Timer, TimerInterrupt)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, false);
-    TimerEnable(SWTimer2, 5, (timerCallback)&timer2Callback, false);
-    TimerEnable(SWTimer3, 7, (timerCallback)&timer3Callback, false);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 5, setFlagCallback, &t2Cb, false);
+    TimerStart(timer3, 7, setFlagCallback, &t3Cb, false);
 
     SetTimerCount(5);
 
     TimerInterrupt();
 
-    LONGS_EQUAL(0, timer1->timeLeft);
+    LONGS_EQUAL(0, TimerTimeLeft(timer1));
     CHECK_FALSE(timer1->isActive);
     CHECK_TRUE(t1Cb);
 
-    LONGS_EQUAL(0, timer2->timeLeft);
+    LONGS_EQUAL(0, TimerTimeLeft(timer2));
     CHECK_FALSE(timer2->isActive);
     CHECK_TRUE(t2Cb);
 
-    LONGS_EQUAL(2, timer3->timeLeft);
+    LONGS_EQUAL(2, TimerTimeLeft(timer3));
     CHECK_TRUE(timer3->isActive);
     CHECK_FALSE(t3Cb);
 
@@ -261,9 +254,9 @@ TEST(Timer, TimerInterrupt)
  */
 TEST(Timer, TimerReload)
 {
-    TimerEnable(SWTimer1, 3, (timerCallback)&timer1Callback, true);
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, true);
 
-    LONGS_EQUAL(3, timer1->timeLeft);
+    LONGS_EQUAL(3, TimerTimeLeft(timer1));
     CHECK_TRUE(timer1->isActive);
     CHECK_FALSE(t1Cb);
 
@@ -272,13 +265,300 @@ TEST(Timer, TimerReload)
 
     TimerInterrupt();
 
-    // The timer should still be active. Note that 3 is still time left, not 2. This is on purpose, we always reload with the
-    // original value, regardless of how much time has passed.
-    LONGS_EQUAL(3, timer1->timeLeft);
+    // The timer should still be active. The next deadline is 6, a period after the last one, so only 1 is left
+    // rather than a full period. The 2 counts the interrupt was late by aren't added on.
+    LONGS_EQUAL(1, TimerTimeLeft(timer1));
     CHECK_TRUE(timer1->isActive);
     CHECK_TRUE(t1Cb);
+    LONGS_EQUAL(0, TimerMissedPeriods(timer1));
 
     CheckNextTimer(timer1);
-    CheckTimerCompare(3);
+    CheckTimerCompare(1);
+}
+
+/*
+ * A reloading timer serviced late each time still fires on its original period
+ */
+TEST(Timer, TimerReloadNoDrift)
+{
+    TIME late[] = {1, 4, 0, 9, 2};
+    unsigned int i;
+
+    TimerStart(timer1, 10, setFlagCallback, &t1Cb, true);
+
+    for(i = 0; i < sizeof(late) / sizeof(late[0]); i++)
+    {
+        t1Cb = false;
+
+        SetTimerCount(10 * (i + 1) + late[i]);
+        TimerInterrupt();
+
+        CHECK_TRUE(t1Cb);
+        LONGS_EQUAL(10 * (i + 2), timer1->deadline);
+        LONGS_EQUAL(10 - late[i], TimerTimeLeft(timer1));
+    }
+
+    LONGS_EQUAL(0, TimerMissedPeriods(timer1));
+}
+
+/*
+ * A reloading timer that falls more than a period behind skips the missed periods, fires once, and counts them
+ */
+TEST(Timer, TimerReloadMissedPeriods)
+{
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, true);
+
+    // Deadlines 3, 6 and 9 have all passed
+    SetTimerCount(10);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    LONGS_EQUAL(2, TimerMissedPeriods(timer1));
+    LONGS_EQUAL(12, timer1->deadline);
+    LONGS_EQUAL(2, TimerTimeLeft(timer1));
+    CheckTimerCompare(2);
+
+    // Landing exactly on a later deadline counts that period as missed as well
+    t1Cb = false;
+    SetTimerCount(18);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    LONGS_EQUAL(4, TimerMissedPeriods(timer1));
+    LONGS_EQUAL(21, timer1->deadline);
+
+    // Restarting the timer clears the count
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, true);
+    LONGS_EQUAL(0, TimerMissedPeriods(timer1));
+}
+
+
+/*
+ * Timers enabled out of order fire in deadline order, one interrupt each
+ */
+TEST(Timer, FireInDeadlineOrder)
+{
+    TimerStart(timer1, 7, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 3, setFlagCallback, &t2Cb, false);
+    TimerStart(timer3, 5, setFlagCallback, &t3Cb, false);
+
+    CheckNextTimer(timer2);
+
+    SetTimerCount(3);
+    TimerInterrupt();
+
+    CHECK_TRUE(t2Cb);
+    CHECK_FALSE(t3Cb);
+    CheckNextTimer(timer3);
+    CheckTimerCompare(2);
+
+    SetTimerCount(5);
+    TimerInterrupt();
+
+    CHECK_TRUE(t3Cb);
+    CHECK_FALSE(t1Cb);
+    CheckNextTimer(timer1);
+    CheckTimerCompare(2);
+
+    SetTimerCount(7);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    CheckNextTimer(NULL);
+}
+
+/*
+ * Enabling a timer that's already running restarts it with the new time
+ */
+TEST(Timer, TimerReEnable)
+{
+    TimerStart(timer1, 3, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 5, setFlagCallback, &t2Cb, false);
+
+    SetTimerCount(1);
+    TimerStart(timer1, 9, setFlagCallback, &t1Cb, false);
+
+    CheckNextTimer(timer2);
+    LONGS_EQUAL(9, TimerTimeLeft(timer1));
+
+    SetTimerCount(5);
+    TimerInterrupt();
+
+    CHECK_TRUE(t2Cb);
+    CHECK_FALSE(t1Cb);
+    CheckNextTimer(timer1);
+    CheckTimerCompare(5);
+}
+
+/*
+ * Deadlines are compared allowing for the hardware counter wrapping around
+ */
+TEST(Timer, TimerCounterWrap)
+{
+    SetTimerCount(TIMER_MAX - 1);
+
+    TimerStart(timer1, 4, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 1, setFlagCallback, &t2Cb, false);
+
+    CheckNextTimer(timer2);
+
+    SetTimerCount(1);
+    TimerInterrupt();
+
+    CHECK_TRUE(t2Cb);
+    CHECK_FALSE(t1Cb);
+    LONGS_EQUAL(1, TimerTimeLeft(timer1));
+}
+
+/*
+ * Timers whose windows overlap share one interrupt, set for when the first window closes
+ */
+TEST(Timer, SlackCoalesces)
+{
+    uintd_t saved = TimerInterruptsSaved();
+
+    TimerSetSlack(timer1, 10);
+
+    TimerStart(timer1, 10, setFlagCallback, &t1Cb, false);
+    CheckTimerCompare(20);
+
+    // timer2's window closes first, so the hardware timer is brought forward to it
+    TimerStart(timer2, 15, setFlagCallback, &t2Cb, false);
+    CheckTimerCompare(15);
+
+    TimerStart(timer3, 30, setFlagCallback, &t3Cb, false);
+    CheckTimerCompare(15);
+
+    SetTimerCount(15);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    CHECK_TRUE(t2Cb);
+    CHECK_FALSE(t3Cb);
+    LONGS_EQUAL(saved + 1, TimerInterruptsSaved());
+
+    CheckNextTimer(timer3);
+    CheckTimerCompare(15);
+}
+
+/*
+ * Slack only lets a timer fire late, a timer whose deadline hasn't passed waits for its own interrupt
+ */
+TEST(Timer, SlackNeverEarly)
+{
+    uintd_t saved = TimerInterruptsSaved();
+
+    TimerSetSlack(timer1, 5);
+    TimerSetSlack(timer2, 100);
+
+    TimerStart(timer1, 10, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 20, setFlagCallback, &t2Cb, false);
+    CheckTimerCompare(15);
+
+    SetTimerCount(15);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    CHECK_FALSE(t2Cb);
+    LONGS_EQUAL(saved, TimerInterruptsSaved());
+
+    // timer2 is now alone, so it can wait out all of its slack
+    CheckTimerCompare(105);
+}
+
+/*
+ * Without slack, timers caught together by a late interrupt don't count as saved interrupts
+ */
+TEST(Timer, LateInterruptSavesNothing)
+{
+    uintd_t saved = TimerInterruptsSaved();
+
+    TimerStart(timer1, 10, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 11, setFlagCallback, &t2Cb, false);
+    CheckTimerCompare(10);
+
+    SetTimerCount(20);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    CHECK_TRUE(t2Cb);
+    LONGS_EQUAL(saved, TimerInterruptsSaved());
+}
+
+/*
+ * Stopping the timer the hardware timer was set for lets it fire later
+ */
+TEST(Timer, SlackStop)
+{
+    TimerSetSlack(timer1, 20);
+
+    TimerStart(timer1, 10, setFlagCallback, &t1Cb, false);
+    TimerStart(timer2, 20, setFlagCallback, &t2Cb, false);
+    CheckTimerCompare(20);
+
+    TimerStop(timer2);
+    CheckTimerCompare(30);
+}
+
+/*
+ * The clock carries on counting up as the hardware counter wraps around
+ */
+TEST(Timer, ClockExtends)
+{
+    SetTimerCount(TIMER_MAX - 1);
+    CHECK(GetClock() == TIMER_MAX - 1);
+
+    SetTimerCount(3);
+    CHECK(GetClock() == (TIME64)TIMER_MAX + 4);
+
+    SetTimerCount(2);
+    CHECK(GetClock() == 2 * ((TIME64)TIMER_MAX + 1) + 2);
 }
 
+/*
+ * An absolute deadline further away than the hardware counter's range is reached in steps
+ */
+TEST(Timer, TimerStartAtFarDeadline)
+{
+    TIME64 deadline = (TIME64)TIMER_MAX + 11;
+
+    TimerStartAt(timer1, deadline, setFlagCallback, &t1Cb);
+
+    CheckNextTimer(timer1);
+    CheckTimerCompare(TIMER_MAX / 2);
+    LONGS_EQUAL(TIMER_MAX, TimerTimeLeft(timer1));
+
+    SetTimerCount(TIMER_MAX / 2);
+    TimerInterrupt();
+
+    CHECK_FALSE(t1Cb);
+    CheckTimerCompare(TIMER_MAX / 2);
+
+    SetTimerCount(TIMER_MAX);
+    TimerInterrupt();
+
+    CHECK_FALSE(t1Cb);
+    LONGS_EQUAL(11, TimerTimeLeft(timer1));
+
+    // Past the wrap around
+    SetTimerCount(10);
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+    CHECK_FALSE(timer1->isActive);
+}
+
+/*
+ * An absolute deadline that has already passed fires at the next interrupt
+ */
+TEST(Timer, TimerStartAtPassed)
+{
+    SetTimerCount(100);
+
+    TimerStartAt(timer1, 50, setFlagCallback, &t1Cb);
+    CheckTimerCompare(0);
+
+    TimerInterrupt();
+
+    CHECK_TRUE(t1Cb);
+}
@@ -0,0 +1,129 @@
+// 2015 Adam Jesionowski
+
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "timer.h"
+#include "timerDaemon.h"
+#include "rtos.h"
+#include "config.h"
+
+// Fake hardware timer register
+extern TIME timerReg;
+
+// Variables from timer.c
+extern TIME timeTimerSet;
+extern Timer_t* nextTimer;
+
+static Timer_t daemonTimers[TIMER_DAEMON_QUEUE_SIZE + 1];
+static bool    fired[TIMER_DAEMON_QUEUE_SIZE + 1];
+
+static void daemonCallback(void* arg){ *(bool*)arg = true; }
+
+TEST_GROUP(TimerDaemon)
+{
+    void setup()
+    {
+        RTOS_Initialize();
+
+        timeTimerSet = 0;
+        timerReg = 0;
+        nextTimer = NULL;
+
+        memset(daemonTimers, 0, sizeof(daemonTimers));
+        memset(fired, 0, sizeof(fired));
+
+        TimerDaemon_init();
+    }
+
+    void teardown()
+    {
+        TimerDaemonReset();
+    }
+};
+
+TEST(TimerDaemon, CallbackRunsInDaemon)
+{
+    TimerStart(&daemonTimers[0], 100, daemonCallback, &fired[0], false);
+
+    timerReg = 100;
+    TimerInterrupt();
+
+    // The interrupt only posts the callback
+    CHECK(!fired[0]);
+    CHECK(!daemonTimers[0].isActive);
+
+    TimerDaemonService();
+
+    CHECK(fired[0]);
+}
+
+TEST(TimerDaemon, ISRCallbackRunsDirectly)
+{
+    TimerStartISR(&daemonTimers[0], 100, daemonCallback, &fired[0], false);
+    TimerStart(&daemonTimers[1], 100, daemonCallback, &fired[1], false);
+
+    timerReg = 100;
+    TimerInterrupt();
+
+    CHECK(fired[0]);
+    CHECK(!fired[1]);
+
+    TimerDaemonService();
+
+    CHECK(fired[1]);
+}
+
+TEST(TimerDaemon, NotStarted)
+{
+    TimerDaemonReset();
+
+    TimerStart(&daemonTimers[0], 100, daemonCallback, &fired[0], false);
+
+    timerReg = 100;
+    TimerInterrupt();
+
+    CHECK(fired[0]);
+}
+
+TEST(TimerDaemon, QueueFullDropsCallback)
+{
+    int i;
+
+    for(i = 0; i < TIMER_DAEMON_QUEUE_SIZE + 1; i++)
+    {
+        TimerStart(&daemonTimers[i], 100 + i, daemonCallback, &fired[i], false);
+    }
+
+    timerReg = 200;
+    TimerInterrupt();
+
+    LONGS_EQUAL(1, TimerDaemonDropped());
+
+    // The ones that fit are called in deadline order
+    for(i = 0; i < TIMER_DAEMON_QUEUE_SIZE; i++)
+    {
+        TimerDaemonService();
+        CHECK(fired[i]);
+    }
+
+    CHECK(!fired[TIMER_DAEMON_QUEUE_SIZE]);
+}
+
+TEST(TimerDaemon, ReloadKeepsPosting)
+{
+    TimerStart(&daemonTimers[0], 100, daemonCallback, &fired[0], true);
+
+    timerReg = 100;
+    TimerInterrupt();
+    TimerDaemonService();
+
+    CHECK(fired[0]);
+    CHECK(daemonTimers[0].isActive);
+
+    fired[0] = false;
+    timerReg = 200;
+    TimerInterrupt();
+    TimerDaemonService();
+
+    CHECK(fired[0]);
+}
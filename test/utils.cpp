@@ -0,0 +1,21 @@
+// 2015 Adam Jesionowski
+
+#include <string.h>
+#include "CppUTest/TestHarness.h"
+#include "utils.h"
+#include "rtos.h"
+
+/*
+ * Start a task and make it the current task
+ */
+void RunTask(Task_t* task, uint8_t prio)
+{
+    memset(task, 0, sizeof(Task_t));
+    task->priority       = prio;
+    task->taskList.owner = task;
+
+    StartTask(task);
+    Tick();
+
+    POINTERS_EQUAL(task, GetCurrentTask());
+}
@@ -4,12 +4,50 @@
 #include "port.h"
 #include "timer.h"
 #include "rtos.h"
+#include "timerDaemon.h"
 
 // Non-static due to testing.
-Timer_t  timers[NUM_TIMERS];
+// Active timers are kept in a pairing heap ordered by deadline, and nextTimer is its root.
 volatile Timer_t* nextTimer;
 volatile TIME     timeTimerSet;
 
+// The hardware timer count is extended to 64 bits by adding each wrap around it makes to clockHigh.
+// clockLast is the count GetClock last read.
+volatile TIME64   clockHigh;
+volatile TIME     clockLast;
+
+// When the hardware timer was last set to fire, and how many interrupts coalescing has saved
+static TIME64  fireTime;
+static uintd_t interruptsSaved;
+
+/*
+ * Returns the hardware timer count, extended to 64 bits so that it never wraps. A wrap around is noticed
+ * when the count is less than it was at the last read, so this must be called at least once per wrap.
+ * Tick and the timer interrupt both call it, and the hardware timer is never set for more than half a wrap.
+ * With tickless idle, PortSuppressTicks must not stop the tick for longer than one wrap.
+ */
+TIME64 GetClock()
+{
+    TIME64 now;
+    TIME   count;
+
+    ENTER_CRITICAL_SECTION;
+
+    count = READ_TIMER_REGISTER();
+
+    if(count < clockLast)
+    {
+        clockHigh += (TIME64)TIMER_MAX + 1;
+    }
+
+    clockLast = count;
+    now = clockHigh + count;
+
+    EXIT_CRITICAL_SECTION;
+
+    return now;
+}
+
 /*
  * This function mainly serves as a wrapper for setting the hardware timer.
  */
@@ -21,166 +59,444 @@ void StartHardwareTimer(TIME time)
 }
 
 /*
- * Starts a timer.
+ * Deadlines are 64-bit clock counts, which don't wrap, so they can be compared directly
  */
-void TimerEnable(SW_TIMER timer, TIME time, timerCallback callback, bool reload)
+static bool DeadlineBefore(TIME64 a, TIME64 b)
 {
-    ENTER_CRITICAL_SECTION;
+    return a < b;
+}
 
-    Timer_t* t = &timers[timer];
+/*
+ * Returns how long until the deadline, or 0 if it has passed
+ */
+static TIME64 TimeUntil(TIME64 deadline, TIME64 now)
+{
+    if(DeadlineBefore(now, deadline))
+    {
+        return deadline - now;
+    }
 
-    t->isActive     = true;
-    t->timeLeft     = time;
-    t->originalTime = time;
-    t->callback     = callback;
-    t->reload       = reload;
+    return 0;
+}
 
-    if(nextTimer == NULL)
+/*
+ * The heap functions below keep active timers in a pairing heap. Each timer points at its first child
+ * and next sibling, and prev points back at its previous sibling, or its parent if it is a first child.
+ * Inserting is O(1), and removing the root or any other timer is O(log n) amortized.
+ */
+
+/*
+ * Combine two heaps, returning the new root
+ */
+static Timer_t* HeapMeld(Timer_t* a, Timer_t* b)
+{
+    Timer_t* t;
+
+    if(a == NULL)
     {
-    	// If there is no next timer, make it this one
-        nextTimer = t;
-        StartHardwareTimer(time);
+        return b;
     }
-    else if(time < nextTimer->timeLeft)
+
+    if(b == NULL)
     {
-    	// Set this timer as next if it has less time remaining. TimerUpdate will set this
-        TimerUpdate();
-        StartHardwareTimer(time);
+        return a;
     }
 
-    EXIT_CRITICAL_SECTION;
+    // a will be the root, b becomes its first child
+    if(DeadlineBefore(b->deadline, a->deadline))
+    {
+        t = a;
+        a = b;
+        b = t;
+    }
+
+    b->sibling = a->child;
+
+    if(a->child != NULL)
+    {
+        a->child->prev = b;
+    }
+
+    b->prev  = a;
+    a->child = b;
+
+    a->sibling = NULL;
+    a->prev    = NULL;
+
+    return a;
 }
 
 /*
- * Starts a timer while inside a timer callback
+ * Combine a list of sibling heaps into one. They are melded in pairs from left to right, then the pairs are
+ * melded from right to left, which is what keeps the heap's amortized costs down.
  */
-void TimerEnableInCallback(SW_TIMER timer, TIME time, timerCallback callback, bool reload)
+static Timer_t* HeapMergePairs(Timer_t* first)
 {
-    Timer_t* t = &timers[timer];
+    Timer_t* pairs = NULL;
+    Timer_t* root  = NULL;
 
-    t->isActive     = true;
-    t->timeLeft     = time;
-    t->originalTime = time;
-    t->callback     = callback;
-    t->reload       = reload;
+    // First pass, the melded pairs are pushed onto a list through their sibling pointers, so it ends up reversed
+    while(first != NULL)
+    {
+        Timer_t* a = first;
+        Timer_t* b = first->sibling;
+        Timer_t* pair;
+
+        first = (b != NULL) ? b->sibling : NULL;
 
-    // Set nextTimer if applicable
-    if(time < nextTimer->timeLeft)
+        a->sibling = NULL;
+        a->prev    = NULL;
+
+        if(b != NULL)
+        {
+            b->sibling = NULL;
+            b->prev    = NULL;
+        }
+
+        pair = HeapMeld(a, b);
+        pair->sibling = pairs;
+        pairs = pair;
+    }
+
+    // Second pass
+    while(pairs != NULL)
     {
-    	nextTimer = t;
+        Timer_t* next = pairs->sibling;
+
+        pairs->sibling = NULL;
+        root  = HeapMeld(root, pairs);
+        pairs = next;
     }
+
+    return root;
+}
+
+static void HeapInsert(Timer_t* t)
+{
+    t->child   = NULL;
+    t->sibling = NULL;
+    t->prev    = NULL;
+
+    nextTimer = HeapMeld((Timer_t*)nextTimer, t);
 }
 
 /*
- * Stops a timer.
+ * Walk back along t's siblings to find its parent
  */
-void TimerDisable(SW_TIMER timer)
+static Timer_t* HeapParent(Timer_t* t)
 {
-    ENTER_CRITICAL_SECTION;
+    while(t->prev->child != t)
+    {
+        t = t->prev;
+    }
 
-    Timer_t* t = &timers[timer];
+    return t->prev;
+}
 
-    if(t->isActive)
+static void HeapRemove(Timer_t* t)
+{
+    if(t == nextTimer)
     {
-        t->isActive = false;
+        nextTimer = HeapMergePairs(t->child);
+    }
+    else
+    {
+        // Unlink t (and everything below it) from its siblings, then meld its children back in
+        if(t->prev->child == t)
+        {
+            t->prev->child = t->sibling;
+        }
+        else
+        {
+            t->prev->sibling = t->sibling;
+        }
 
-        // If this was supposed to be the next timer to trigger, handle that
-        if(t == nextTimer)
+        if(t->sibling != NULL)
         {
-            TimerUpdate();
+            t->sibling->prev = t->prev;
+        }
 
-            // If there's a next timer, start hw timer again
-            if(nextTimer)
+        nextTimer = HeapMeld((Timer_t*)nextTimer, HeapMergePairs(t->child));
+    }
+
+    t->child   = NULL;
+    t->sibling = NULL;
+    t->prev    = NULL;
+}
+
+/*
+ * Returns the latest time the hardware timer can fire without any timer firing after its deadline plus slack.
+ * Every timer with a deadline before then fires in the same interrupt.
+ *
+ * Only timers with a deadline before that time can bring it forward, and as a timer's children have later
+ * deadlines than it does, the heap is only walked as far as timers that will fire in the next interrupt anyway.
+ */
+static TIME64 FireTime()
+{
+    Timer_t* root   = (Timer_t*)nextTimer;
+    Timer_t* t      = root->child;
+    TIME64   latest = root->deadline + root->slack;
+
+    // Without slack on the first timer, nothing can fire any later than it
+    if(root->slack == 0)
+    {
+        return latest;
+    }
+
+    while(t != NULL)
+    {
+        if(DeadlineBefore(t->deadline, latest))
+        {
+            if(DeadlineBefore(t->deadline + t->slack, latest))
             {
-                StartHardwareTimer(nextTimer->timeLeft);
+                latest = t->deadline + t->slack;
+            }
+
+            if(t->child != NULL)
+            {
+                t = t->child;
+                continue;
             }
         }
+
+        // Move on to the next sibling, climbing back up once a row of siblings is done
+        while(t != root && t->sibling == NULL)
+        {
+            t = HeapParent(t);
+        }
+
+        t = (t == root) ? NULL : t->sibling;
+    }
+
+    return latest;
+}
+
+/*
+ * Set the hardware timer to fire at the passed clock count. Deadlines more than half the hardware counter's range
+ * away are reached in steps, so that GetClock sees every wrap around.
+ */
+static void SetHardwareTimer(TIME64 fire)
+{
+    TIME64 time = TimeUntil(fire, GetClock());
+
+    fireTime = fire;
+
+    if(time > TIMER_MAX / 2)
+    {
+        time = TIMER_MAX / 2;
+    }
+
+    StartHardwareTimer((TIME)time);
+}
+
+/*
+ * Set a timer's fields and put it in the heap, taking it out first if it was already running
+ */
+static void StartTimer(Timer_t* t, TIME64 deadline, TIME period, timerCallback callback, void* arg, bool reload, bool inISR)
+{
+    if(t->isActive)
+    {
+        HeapRemove(t);
+    }
+
+    t->isActive     = true;
+    t->deadline     = deadline;
+    t->originalTime = period;
+    t->callback     = callback;
+    t->arg          = arg;
+    t->reload       = reload;
+    t->inISR        = inISR;
+    t->missed       = 0;
+
+    HeapInsert(t);
+}
+
+/*
+ * Starts a timer from a task, setting the hardware timer sooner if it needs to be
+ */
+static void StartTimerFromTask(Timer_t* t, TIME64 deadline, TIME period, timerCallback callback, void* arg, bool reload, bool inISR)
+{
+    TIME64 latest;
+
+    ENTER_CRITICAL_SECTION;
+
+    StartTimer(t, deadline, period, callback, arg, reload, inISR);
+
+    latest = t->deadline + t->slack;
+
+    // If this is the only timer, or its window closes before the hardware timer fires, the hardware timer needs to fire sooner.
+    // Otherwise it already fires in time for this timer.
+    if((t == nextTimer && t->child == NULL) || DeadlineBefore(latest, fireTime))
+    {
+        SetHardwareTimer(latest);
     }
 
     EXIT_CRITICAL_SECTION;
 }
 
 /*
- * Timers themselves do not tick down at regular intervals. Instead, when anything occurs
- * that requires the timer values or nextTimer to change (hardware timer interrupt occurs,
- * a new timer is added), then this function is called to update the time left on each timer
- * and set the nextTimer that needs to fire.
+ * Starts a timer. The timer fires after time hardware timer counts, calling callback with arg. If the timer
+ * daemon is running, the callback is called from the daemon task.
  */
-void TimerUpdate()
+void TimerStart(Timer_t* t, TIME time, timerCallback callback, void* arg, bool reload)
+{
+    StartTimerFromTask(t, GetClock() + time, time, callback, arg, reload, false);
+}
+
+/*
+ * As TimerStart, but the callback is always called from the timer interrupt, even if the timer daemon is running.
+ */
+void TimerStartISR(Timer_t* t, TIME time, timerCallback callback, void* arg, bool reload)
+{
+    StartTimerFromTask(t, GetClock() + time, time, callback, arg, reload, true);
+}
+
+/*
+ * Starts a one shot timer that fires when GetClock reaches deadline, calling callback with arg. A deadline that has
+ * already passed fires at the next timer interrupt.
+ */
+void TimerStartAt(Timer_t* t, TIME64 deadline, timerCallback callback, void* arg)
 {
-    uintd_t i;
-    TIME differential;
-    TIME timeNow = READ_TIMER_REGISTER();
+    StartTimerFromTask(t, deadline, 0, callback, arg, false, false);
+}
 
-    // When we update, use a fake timer as the next one
-    static Timer_t lastTimer = {
-        false,
-        false,
-        TIMER_MAX,
-        TIMER_MAX,
-        NULL
-    };
+/*
+ * Starts a timer while inside a timer callback run from the interrupt. TimerInterrupt sets the hardware timer
+ * once the callbacks are done. Callbacks run by the timer daemon should use TimerStart.
+ */
+void TimerStartInCallback(Timer_t* t, TIME time, timerCallback callback, void* arg, bool reload)
+{
+    StartTimer(t, GetClock() + time, time, callback, arg, reload, false);
+}
 
-    nextTimer = &lastTimer;
+/*
+ * Stops a timer.
+ */
+void TimerStop(Timer_t* t)
+{
+    ENTER_CRITICAL_SECTION;
 
-    if(timeNow < timeTimerSet)
+    if(t->isActive)
     {
-        // In this case, the timer has overflowed since it was last set. Calculate the differential accordingly.
-        differential = (TIMER_MAX - timeTimerSet) + timeNow;
+        bool wasNext = (t == nextTimer) || (t->deadline + t->slack == fireTime);
+
+        t->isActive = false;
+        HeapRemove(t);
+
+        // If this was supposed to be the next timer to trigger, start the hw timer again for the new next timer
+        if(wasNext && nextTimer)
+        {
+            SetHardwareTimer(FireTime());
+        }
     }
-    else
+
+    EXIT_CRITICAL_SECTION;
+}
+
+/*
+ * Returns how many hardware timer counts are left before the timer fires, or 0 if it isn't active.
+ * Timers started with TimerStartAt may be further away than TIME can hold, in which case this returns TIMER_MAX.
+ */
+TIME TimerTimeLeft(Timer_t* timer)
+{
+    TIME64 left;
+
+    if(!timer->isActive)
     {
-        differential = timeNow - timeTimerSet;
+        return 0;
     }
 
-    for(i = 0; i < NUM_TIMERS; i++)
+    left = TimeUntil(timer->deadline, GetClock());
+
+    return (left > TIMER_MAX) ? TIMER_MAX : (TIME)left;
+}
+
+/*
+ * Lets a timer fire up to slack hardware timer counts after its deadline, so that it can share an interrupt
+ * with other timers. Set it before starting the timer, it is kept when the timer is restarted.
+ */
+void TimerSetSlack(Timer_t* timer, TIME slack)
+{
+    timer->slack = slack;
+}
+
+/*
+ * Returns how many timer interrupts have been saved by firing timers with different deadlines together
+ */
+uintd_t TimerInterruptsSaved()
+{
+    return interruptsSaved;
+}
+
+/*
+ * Returns how many periods a reloading timer has skipped since it was started, because it expired
+ * more than a whole period late
+ */
+uintd_t TimerMissedPeriods(Timer_t* timer)
+{
+    return timer->missed;
+}
+
+/*
+ * When anything occurs that may have made timers expire (the hardware timer interrupt), this function is called.
+ * It takes each expired timer off the front of the heap, reloads it if needed, and calls its callback (or
+ * posts it to the timer daemon).
+ * Timers that haven't expired aren't touched.
+ */
+void TimerUpdate()
+{
+    TIME64 now   = GetClock();
+    bool   first = true;
+    TIME64 lastDeadline = 0;
+
+    while(nextTimer != NULL && !DeadlineBefore(now, nextTimer->deadline))
     {
-        Timer_t* t = &timers[i];
+        Timer_t* t = (Timer_t*)nextTimer;
+
+        HeapRemove(t);
 
-        // We only care about active timers
-        if(t->isActive)
+        // Each later deadline that the hardware timer was set to wait for would have needed its own interrupt
+        // without slack. Deadlines after fireTime are only here because the interrupt ran late.
+        if(!first && t->deadline != lastDeadline && !DeadlineBefore(fireTime, t->deadline))
         {
-            // If differential is less than the time left, just subtract it and move on
-            if(differential < t->timeLeft)
-            {
-                t->timeLeft -= differential;
+            interruptsSaved++;
+        }
 
-                // Check if this should be nextTimer
-                if(t->timeLeft < nextTimer->timeLeft)
-                {
-                    nextTimer = t;
-                }
-            }
-            else
+        first        = false;
+        lastDeadline = t->deadline;
+
+        // If this timer auto-reloads, do so. A reload time of 0 would expire forever, so it only fires once.
+        if(t->reload && t->originalTime != 0)
+        {
+            // The next deadline follows on from this one, not from now, so that late interrupts don't add up
+            t->deadline += t->originalTime;
+
+            // If we're so late that further periods have passed too, skip and count them rather than firing them all at once
+            if(!DeadlineBefore(now, t->deadline))
             {
-            	// If this timer auto-reloads, do so
-                if(t->reload)
-                {
-                    t->timeLeft = t->originalTime;
-
-                    // Also check if this one should be nextTimer
-                    if(t->timeLeft < nextTimer->timeLeft)
-                    {
-                        nextTimer = t;
-                    }
-                }
-                else
-                {
-                    // Otherwise, this timer is done.
-                    t->isActive = false;
-                    t->timeLeft = 0;
-                }
-
-                // Call the callback function
-            	t->callback();
+                TIME64 skipped = (now - t->deadline) / t->originalTime + 1;
+
+                t->deadline += skipped * t->originalTime;
+                t->missed   += skipped;
             }
+
+            HeapInsert(t);
+        }
+        else
+        {
+            // Otherwise, this timer is done.
+            t->isActive = false;
         }
-    }
 
-    // If nextTimer did not change, set it to NULL
-    if(nextTimer == &lastTimer)
-    {
-        nextTimer = NULL;
+        // Call the callback function, or have the timer daemon call it
+#ifdef TIMER_DAEMON
+        if(!t->inISR && TimerDaemonIsRunning())
+        {
+            TimerDaemonPost(t->callback, t->arg);
+            continue;
+        }
+#endif
+        t->callback(t->arg);
     }
 }
 
@@ -199,7 +515,25 @@ void TimerInterrupt()
         // And start again if there's a next timer
         if(nextTimer)
         {
-            StartHardwareTimer(nextTimer->timeLeft);
+            SetHardwareTimer(FireTime());
         }
     }
 }
+
+/*
+ * Returns how many whole ticks will pass before the next timer fires. Used by tickless idle so the tick
+ * is not suppressed past a timer deadline.
+ */
+uintd_t TimerTicksUntilNext()
+{
+    TIME64 ticks;
+
+    if(nextTimer == NULL)
+    {
+        return MAX_DELAY_TICKS;
+    }
+
+    ticks = TimeUntil(fireTime, GetClock()) / TIMER_COUNTS_PER_TICK;
+
+    return (ticks > MAX_DELAY_TICKS) ? MAX_DELAY_TICKS : (uintd_t)ticks;
+}
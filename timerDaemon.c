@@ -0,0 +1,101 @@
+// 2015 Adam Jesionowski
+
+#include "timerDaemon.h"
+#include "config.h"
+#include "port.h"
+#include "queue.h"
+#include "rtos.h"
+
+#ifdef TIMER_DAEMON
+
+static uintd_t     TimerDaemon_stack[DFLT_STACK_SIZE];
+static TimerCall_t TimerDaemon_calls[TIMER_DAEMON_QUEUE_SIZE];
+static Queue_t     TimerDaemon_queue;
+static bool        running;
+static uintd_t     dropped;
+
+Task_t timerDaemonTask =
+{
+    TIMER_DAEMON_PRIORITY,
+    {NULL, NULL, &timerDaemonTask},
+    0,
+    TimerDaemon_stack
+};
+
+void TimerDaemon_init()
+{
+    InitQueue(&TimerDaemon_queue, (uint8_t*)TimerDaemon_calls, sizeof(TimerCall_t), TIMER_DAEMON_QUEUE_SIZE);
+    dropped = 0;
+
+    timerDaemonTask.stackPtr = &TimerDaemon_stack[DFLT_STACK_SIZE-1];
+    timerDaemonTask.stackPtr = (uintd_t*)InitStack(timerDaemonTask.stackPtr, TimerDaemon_main);
+    StartTask(&timerDaemonTask);
+
+    running = true;
+}
+
+void TimerDaemon_main()
+{
+    while(1)
+    {
+        TimerDaemonService();
+    }
+}
+
+/*
+ * Wait for the next posted callback and call it
+ */
+void TimerDaemonService()
+{
+    TimerCall_t call;
+
+    DequeueBlocking(&TimerDaemon_queue, (uint8_t*)&call);
+
+    call.callback(call.arg);
+}
+
+/*
+ * Called from TimerUpdate to hand a callback to the daemon. Returns true, and counts the callback as
+ * dropped, if the queue is full.
+ */
+bool TimerDaemonPost(timerCallback callback, void* arg)
+{
+    TimerCall_t call;
+    bool error;
+
+    call.callback = callback;
+    call.arg      = arg;
+
+    error = Enqueue(&TimerDaemon_queue, (uint8_t*)&call);
+
+    if(error)
+    {
+        dropped++;
+    }
+
+    return error;
+}
+
+bool TimerDaemonIsRunning()
+{
+    return running;
+}
+
+/*
+ * Returns how many callbacks have been dropped because the daemon's queue was full
+ */
+uintd_t TimerDaemonDropped()
+{
+    return dropped;
+}
+
+/*
+ * Forget the daemon was started, so timer callbacks are called directly again
+ */
+void TimerDaemonReset()
+{
+    running = false;
+    dropped = 0;
+}
+
+#endif /* TIMER_DAEMON */